@@ -4,6 +4,7 @@
 #include "json.h"
 #include "profile.h"
 
+#include <functional>
 #include <list>
 
 using namespace std;
@@ -58,21 +59,21 @@ class SpravIO::PImpl {
   }
 
   void ProcessDialogue(std::istream& input) {
+    // Both sections come from one scanner, it reads ahead
+    LineScanner scanner(input);
     InputReader()
-      .SetCallback([this](string_view line) mutable {
+      .Process(scanner, [this](string_view line) {
         MakeBaseRequest(line)->Process(sprav_);
-      })
-      .Process(input);
+      });
 
     list<ResponsePtr> responses;
     InputReader()
-      .SetCallback([this, &responses](string_view line) mutable {
+      .Process(scanner, [this, &responses](string_view line) {
         auto resp = MakeStatRequest(line)->Process(sprav_);
         if (!resp->empty()) {
           responses.emplace_back(move(resp));
         }
-      })
-      .Process(input);
+      });
     Output(responses.begin(), responses.end());
   }
 
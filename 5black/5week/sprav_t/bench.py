@@ -0,0 +1,76 @@
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import time
+
+parser = argparse.ArgumentParser(description='Benchmarking make_base and process_requests')
+parser.add_argument('binary', help='path to the built main')
+parser.add_argument('--prefix', default='load', help='inputs prefix as written by make_load_base.py')
+parser.add_argument('--repeat', type=int, default=3)
+parser.add_argument('--json', action='store_true', help='print results as json')
+args = parser.parse_args()
+
+
+def parse_loaded_rss(stderr):
+    # The memory report printed once the catalog is built or loaded ends
+    # with an "rss,,<bytes>,<mb>" row: that is the steady state
+    rss = None
+    for line in stderr.decode(errors="replace").splitlines():
+        if line.startswith("rss,,"):
+            rss = int(line.split(",")[2])
+            break
+    return rss
+
+
+def run(mode, input_path):
+    # wait4 gives the rusage of this very child, so peak RSS is per run
+    with open(input_path, "rb") as input_file:
+        start = time.monotonic()
+        proc = subprocess.Popen([args.binary, mode], stdin=input_file,
+                                stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+        stderr = proc.stderr.read()
+        _, status, usage = os.wait4(proc.pid, 0)
+        wall = time.monotonic() - start
+    proc.returncode = os.waitstatus_to_exitcode(status)
+    if proc.returncode != 0:
+        sys.exit(mode + " failed with code " + str(proc.returncode))
+    # ru_maxrss is in kilobytes on Linux
+    return wall, usage.ru_maxrss * 1024, parse_loaded_rss(stderr)
+
+
+make_path = args.prefix + "_make_base.in.json"
+process_path = args.prefix + "_process_requests.in.json"
+with open(make_path) as f:
+    catalog_path = json.load(f)["serialization_settings"]["file"]
+
+results = {}
+for mode, input_path in (("make_base", make_path), ("process_requests", process_path)):
+    walls = []
+    rss = []
+    loaded_rss = []
+    for _ in range(args.repeat):
+        wall, max_rss, loaded = run(mode, input_path)
+        walls.append(wall)
+        rss.append(max_rss)
+        if loaded is not None:
+            loaded_rss.append(loaded)
+    results[mode] = {
+        "wall_min_s": min(walls),
+        "wall_median_s": statistics.median(walls),
+        "peak_rss_bytes": max(rss),
+        "loaded_rss_bytes": max(loaded_rss) if loaded_rss else None
+    }
+results["catalog_bytes"] = os.path.getsize(catalog_path)
+
+if args.json:
+    print(json.dumps(results, indent=2))
+else:
+    for mode in ("make_base", "process_requests"):
+        r = results[mode]
+        print("{}: min {:.3f}s, median {:.3f}s, peak RSS {:.1f} MB, loaded RSS {}".format(
+            mode, r["wall_min_s"], r["wall_median_s"], r["peak_rss_bytes"] / 2 ** 20,
+            "n/a" if r["loaded_rss_bytes"] is None else "{:.1f} MB".format(r["loaded_rss_bytes"] / 2 ** 20)))
+    print("catalog: {:.1f} MB".format(results["catalog_bytes"] / 2 ** 20))
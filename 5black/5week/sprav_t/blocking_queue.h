@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+// Bounded queue between one producer and one consumer thread. A full
+// queue blocks the producer, so it can't run away from the consumer.
+template <typename T>
+class BlockingQueue {
+ public:
+  explicit BlockingQueue(size_t capacity)
+    : capacity_(capacity)
+  {}
+
+  // Waits for free space. False if the queue is closed: nobody will
+  // ever pop the value.
+  bool Push(T value) {
+    std::unique_lock lock(m_);
+    not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+    if (closed_) {
+      return false;
+    }
+    items_.push_back(std::move(value));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // Waits for a value, nullopt once the queue is closed and drained
+  std::optional<T> Pop() {
+    std::unique_lock lock(m_);
+    not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) {
+      return std::nullopt;
+    }
+    T value = std::move(items_.front());
+    items_.pop_front();
+    not_full_.notify_one();
+    return value;
+  }
+
+  // Wakes everybody up. Values already pushed may still be popped.
+  void Close() {
+    std::lock_guard g(m_);
+    closed_ = true;
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+ private:
+  const size_t capacity_;
+
+  std::mutex m_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<T> items_;
+  bool closed_ = false;
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "graph.h"
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace Graph {
+
+  // Single source shortest paths over DirectedWeightedGraph.
+  // Internal arrays are stamped per run, so one object can serve many
+  // searches over the same graph without O(V) resets.
+  template <typename Weight, typename Extra>
+  class Dijkstra {
+  public:
+    using Graph = DirectedWeightedGraph<Weight, Extra>;
+
+    Dijkstra(const Graph& graph);
+
+    // Settles vertices in order of weight; vertices farther than
+    // max_weight are left unreached.
+    void Run(VertexId from, std::optional<Weight> max_weight = std::nullopt);
+
+    // Searches with weights given by edge_weight(edge_id, edge) and stops
+    // as soon as target is settled. Weights are the substituted ones.
+    template <typename EdgeWeight>
+    void RunTo(VertexId from, VertexId target, EdgeWeight edge_weight);
+
+    bool IsReached(VertexId vertex) const;
+    Weight GetWeight(VertexId vertex) const;
+    std::optional<EdgeId> GetPrevEdge(VertexId vertex) const;
+    std::vector<EdgeId> GetPathEdges(VertexId vertex) const;
+
+    // Reached vertices in order of settlement
+    const std::vector<VertexId>& GetReached() const;
+
+  private:
+    const Graph& graph_;
+
+    struct VertexData {
+      uint32_t stamp = 0;
+      bool settled = false;
+      Weight weight;
+      std::optional<EdgeId> prev_edge;
+    };
+    std::vector<VertexData> vertices_;
+    std::vector<VertexId> reached_;
+    uint32_t stamp_ = 0;
+
+    template <typename EdgeWeight>
+    void RunImpl(VertexId from, std::optional<Weight> max_weight, std::optional<VertexId> target, EdgeWeight edge_weight);
+  };
+
+
+  template <typename Weight, typename Extra>
+  Dijkstra<Weight, Extra>::Dijkstra(const Graph& graph)
+    : graph_(graph)
+    , vertices_(graph.GetVertexCount())
+  {}
+
+  template <typename Weight, typename Extra>
+  void Dijkstra<Weight, Extra>::Run(VertexId from, std::optional<Weight> max_weight) {
+    RunImpl(from, max_weight, std::nullopt, [](EdgeId, const Edge<Weight, Extra>& edge) {
+      return edge.weight;
+    });
+  }
+
+  template <typename Weight, typename Extra>
+  template <typename EdgeWeight>
+  void Dijkstra<Weight, Extra>::RunTo(VertexId from, VertexId target, EdgeWeight edge_weight) {
+    RunImpl(from, std::nullopt, target, edge_weight);
+  }
+
+  template <typename Weight, typename Extra>
+  template <typename EdgeWeight>
+  void Dijkstra<Weight, Extra>::RunImpl(VertexId from, std::optional<Weight> max_weight,
+                                        std::optional<VertexId> target, EdgeWeight edge_weight) {
+    using QueueItem = std::pair<Weight, VertexId>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> queue;
+
+    ++stamp_;
+    reached_.clear();
+
+    vertices_[from] = {stamp_, false, 0, std::nullopt};
+    queue.push({0, from});
+
+    while (!queue.empty()) {
+      const auto [weight, vertex] = queue.top();
+      queue.pop();
+
+      auto& data = vertices_[vertex];
+      if (data.settled || weight > data.weight) {
+        continue;
+      }
+      data.settled = true;
+      reached_.push_back(vertex);
+      if (vertex == target) {
+        break;
+      }
+
+      for (const EdgeId edge_id : graph_.GetIncidentEdges(vertex)) {
+        const auto& edge = graph_.GetEdge(edge_id);
+        const Weight candidate_weight = weight + edge_weight(edge_id, edge);
+        assert(candidate_weight >= weight);
+        if (max_weight && candidate_weight > *max_weight) {
+          continue;
+        }
+
+        auto& to = vertices_[edge.to];
+        if (to.stamp != stamp_) {
+          to = {stamp_, false, candidate_weight, edge_id};
+          queue.push({candidate_weight, edge.to});
+        } else if (!to.settled && candidate_weight < to.weight) {
+          to.weight = candidate_weight;
+          to.prev_edge = edge_id;
+          queue.push({candidate_weight, edge.to});
+        }
+      }
+    }
+  }
+
+  template <typename Weight, typename Extra>
+  bool Dijkstra<Weight, Extra>::IsReached(VertexId vertex) const {
+    return vertices_[vertex].stamp == stamp_ && vertices_[vertex].settled;
+  }
+
+  template <typename Weight, typename Extra>
+  Weight Dijkstra<Weight, Extra>::GetWeight(VertexId vertex) const {
+    return vertices_[vertex].weight;
+  }
+
+  template <typename Weight, typename Extra>
+  std::optional<EdgeId> Dijkstra<Weight, Extra>::GetPrevEdge(VertexId vertex) const {
+    return vertices_[vertex].prev_edge;
+  }
+
+  template <typename Weight, typename Extra>
+  std::vector<EdgeId> Dijkstra<Weight, Extra>::GetPathEdges(VertexId vertex) const {
+    std::vector<EdgeId> edges;
+    for (auto edge_id = GetPrevEdge(vertex); edge_id; edge_id = GetPrevEdge(graph_.GetEdge(*edge_id).from)) {
+      edges.push_back(*edge_id);
+    }
+    return {edges.rbegin(), edges.rend()};
+  }
+
+  template <typename Weight, typename Extra>
+  const std::vector<VertexId>& Dijkstra<Weight, Extra>::GetReached() const {
+    return reached_;
+  }
+
+}
@@ -0,0 +1,88 @@
+#include "geo_distance.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace Geo {
+
+namespace {
+
+// Same constants and rounding as GetDistance in stop.cpp, so the exact
+// variant reproduces it bit for bit
+const long double EARTH_RADIUS_M_EXACT = 6371000;
+const long double PI = 3.1415926535;
+
+double grad_to_rad(double v) {
+  return v / 180 * PI;
+}
+
+} // namespace
+
+UnitVector ToUnitVector(double lat, double lon) {
+  const double lat_rad = grad_to_rad(lat);
+  const double lon_rad = grad_to_rad(lon);
+  return {cos(lat_rad) * cos(lon_rad), cos(lat_rad) * sin(lon_rad), sin(lat_rad)};
+}
+
+double ChordToMeters(double chord) {
+  return 2 * asin(min(1.0, chord / 2)) * EARTH_RADIUS_M;
+}
+
+double MetersToChord(double meters) {
+  const double angle = meters / EARTH_RADIUS_M;
+  return angle >= PI ? 2 : 2 * sin(angle / 2);
+}
+
+void Points::Reserve(size_t count) {
+  for (auto* v : {&lat_sin_, &lat_cos_, &lon_, &x_, &y_, &z_}) {
+    v->reserve(count);
+  }
+}
+
+size_t Points::Add(double lat, double lon) {
+  lat_sin_.push_back(sin(grad_to_rad(lat)));
+  lat_cos_.push_back(cos(grad_to_rad(lat)));
+  lon_.push_back(lon);
+  const auto [x, y, z] = ToUnitVector(lat, lon);
+  x_.push_back(x);
+  y_.push_back(y);
+  z_.push_back(z);
+  return lon_.size() - 1;
+}
+
+size_t Points::Size() const {
+  return lon_.size();
+}
+
+vector<double> Points::GetDistances(const IndexPairs& pairs) const {
+  vector<double> result(pairs.size());
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    const auto [a, b] = pairs[i];
+    const double cos_angle = lat_sin_[a] * lat_sin_[b]
+        + lat_cos_[a] * lat_cos_[b] * cos(grad_to_rad(abs(lon_[a] - lon_[b])));
+    result[i] = acos(cos_angle) * EARTH_RADIUS_M_EXACT;
+  }
+  return result;
+}
+
+vector<double> Points::GetApproxDistances(const IndexPairs& pairs) const {
+  vector<double> result(pairs.size());
+  // No calls and no branches: gathers, then a loop the compiler vectorizes
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    const auto [a, b] = pairs[i];
+    const double dx = x_[a] - x_[b];
+    const double dy = y_[a] - y_[b];
+    const double dz = z_[a] - z_[b];
+    result[i] = dx * dx + dy * dy + dz * dz;
+  }
+  for (auto& d : result) {
+    // 2 asin(c / 2) = c + c^3 / 24 + O(c^5)
+    const double chord = sqrt(d);
+    d = (chord + chord * d / 24) * EARTH_RADIUS_M;
+  }
+  return result;
+}
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Geo {
+
+const double EARTH_RADIUS_M = 6371000;
+
+using UnitVector = std::array<double, 3>;
+UnitVector ToUnitVector(double lat, double lon);
+
+// Great-circle length of the chord between two unit vectors, in meters
+double ChordToMeters(double chord);
+double MetersToChord(double meters);
+
+using IndexPairs = std::vector<std::pair<uint32_t, uint32_t>>;
+
+// Batch great-circle distances between points given by index. Per point
+// trigonometry is done once on Add, so a pair costs one cos and one acos
+// in the exact variant and only multiplications in the approximate one.
+class Points {
+ public:
+  void Reserve(size_t count);
+  // Returns the index of the point
+  size_t Add(double lat, double lon);
+  size_t Size() const;
+
+  // Bit-exact with GetDistance(const Stop&, const Stop&)
+  std::vector<double> GetDistances(const IndexPairs& pairs) const;
+  // Chord based, relative error below 1e-6 for points closer than 100 km
+  std::vector<double> GetApproxDistances(const IndexPairs& pairs) const;
+
+ private:
+  std::vector<double> lat_sin_;
+  std::vector<double> lat_cos_;
+  std::vector<double> lon_;
+  std::vector<double> x_;
+  std::vector<double> y_;
+  std::vector<double> z_;
+};
+
+}
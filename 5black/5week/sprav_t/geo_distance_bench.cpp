@@ -0,0 +1,93 @@
+// Compares the batch distance kernel against per pair GetDistance over
+// Stop objects found by name, as CalcBusStats used to do.
+// Usage: geo_distance_bench [points] [pairs]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "geo_distance.h"
+#include "stop.h"
+
+using namespace std;
+
+namespace {
+
+template <typename Func>
+double MeasureNsPerPair(size_t pairs_count, Func func) {
+  const size_t repeat = 5;
+  double best = 0;
+  for (size_t r = 0; r < repeat; ++r) {
+    const auto start = chrono::steady_clock::now();
+    func();
+    const double ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    best = r == 0 ? ns : min(best, ns);
+  }
+  return best / pairs_count;
+}
+
+} // namespace
+
+int main(int argc, const char* argv[]) {
+  const size_t points_count = argc > 1 ? stoul(argv[1]) : 10000;
+  const size_t pairs_count = argc > 2 ? stoul(argv[2]) : 1000000;
+
+  mt19937 rnd(1);
+  uniform_real_distribution<double> lat_dist(55.55, 55.95);
+  uniform_real_distribution<double> lon_dist(37.4, 37.8);
+  uniform_int_distribution<uint32_t> id_dist(0, points_count - 1);
+
+  deque<string> names;
+  unordered_map<string_view, Stop> stops;
+  Geo::Points points;
+  points.Reserve(points_count);
+  for (size_t id = 0; id < points_count; ++id) {
+    const string_view name = names.emplace_back("stop" + to_string(id));
+    Stop& stop = stops[name];
+    stop.id = id;
+    stop.name = name;
+    stop.lat = lat_dist(rnd);
+    stop.lon = lon_dist(rnd);
+    points.Add(stop.lat, stop.lon);
+  }
+
+  Geo::IndexPairs pairs(pairs_count);
+  for (auto& [a, b] : pairs) {
+    a = id_dist(rnd);
+    b = id_dist(rnd);
+  }
+
+  vector<double> scalar(pairs_count);
+  const double scalar_ns = MeasureNsPerPair(pairs_count, [&] {
+    for (size_t i = 0; i < pairs_count; ++i) {
+      scalar[i] = GetDistance(stops.at(names[pairs[i].first]), stops.at(names[pairs[i].second]));
+    }
+  });
+
+  vector<double> exact;
+  const double exact_ns = MeasureNsPerPair(pairs_count, [&] { exact = points.GetDistances(pairs); });
+  vector<double> approx;
+  const double approx_ns = MeasureNsPerPair(pairs_count, [&] { approx = points.GetApproxDistances(pairs); });
+
+  // acos loses precision on short distances, so relative error is
+  // measured over pairs farther than 100 m only
+  size_t mismatches = 0;
+  double max_error = 0;
+  for (size_t i = 0; i < pairs_count; ++i) {
+    const bool both_nan = isnan(exact[i]) && isnan(scalar[i]);
+    mismatches += exact[i] != scalar[i] && !both_nan;
+    if (scalar[i] > 100) {
+      max_error = max(max_error, abs(approx[i] - scalar[i]) / scalar[i]);
+    }
+  }
+
+  cout << "scalar: " << scalar_ns << " ns/pair\n"
+       << "exact:  " << exact_ns << " ns/pair, " << mismatches << " mismatches\n"
+       << "approx: " << approx_ns << " ns/pair, max relative error " << max_error << "\n";
+  return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+#include "geo_index.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+
+#include "geo_distance.h"
+#include "memory_report.h"
+
+using namespace std;
+
+namespace {
+
+const size_t LEAF_SIZE = 8;
+
+using Coords = Geo::UnitVector;
+
+Coords ToUnitVector(GeoIndex::Point p) {
+  return Geo::ToUnitVector(p.lat, p.lon);
+}
+
+// Orders ids so that every node's middle element splits its range by the
+// axis of the widest spread
+void BuildTree(vector<uint32_t>& ids, vector<uint8_t>& axes, const vector<Coords>& coords, size_t begin, size_t end) {
+  if (end - begin <= LEAF_SIZE) {
+    return;
+  }
+
+  uint8_t axis = 0;
+  double max_spread = -1;
+  for (uint8_t a = 0; a < 3; ++a) {
+    const auto [min_it, max_it] = minmax_element(ids.begin() + begin, ids.begin() + end, [&](uint32_t lhs, uint32_t rhs) {
+      return coords[lhs][a] < coords[rhs][a];
+    });
+    if (const double spread = coords[*max_it][a] - coords[*min_it][a]; spread > max_spread) {
+      max_spread = spread;
+      axis = a;
+    }
+  }
+
+  const size_t mid = begin + (end - begin) / 2;
+  nth_element(ids.begin() + begin, ids.begin() + mid, ids.begin() + end, [&](uint32_t lhs, uint32_t rhs) {
+    return coords[lhs][axis] < coords[rhs][axis];
+  });
+  axes[mid] = axis;
+
+  BuildTree(ids, axes, coords, begin, mid);
+  BuildTree(ids, axes, coords, mid + 1, end);
+}
+
+} // namespace
+
+struct GeoIndex::Search {
+  Coords point;
+  size_t count;
+  double max_dist2;
+  // Max-heap of the best candidates by squared chord
+  vector<pair<double, uint32_t>> best;
+
+  double GetBound() const {
+    return best.size() < count ? max_dist2 : best.front().first;
+  }
+
+  void Push(double dist2, uint32_t id) {
+    if (dist2 > GetBound()) {
+      return;
+    }
+    if (best.size() == count) {
+      pop_heap(best.begin(), best.end());
+      best.pop_back();
+    }
+    best.emplace_back(dist2, id);
+    push_heap(best.begin(), best.end());
+  }
+};
+
+GeoIndex::GeoIndex(const vector<Point>& points) {
+  const size_t count = points.size();
+  vector<Coords> coords(count);
+  transform(points.begin(), points.end(), coords.begin(), ToUnitVector);
+
+  ids_.resize(count);
+  iota(ids_.begin(), ids_.end(), 0);
+  axes_.resize(count);
+  BuildTree(ids_, axes_, coords, 0, count);
+
+  x_.reserve(count);
+  y_.reserve(count);
+  z_.reserve(count);
+  for (auto id : ids_) {
+    x_.push_back(coords[id][0]);
+    y_.push_back(coords[id][1]);
+    z_.push_back(coords[id][2]);
+  }
+}
+
+GeoIndex::GeoIndex(const SpravSerialize::GeoIndex& m)
+  : x_(m.x().begin(), m.x().end())
+  , y_(m.y().begin(), m.y().end())
+  , z_(m.z().begin(), m.z().end())
+  , ids_(m.ids().begin(), m.ids().end())
+  , axes_(m.axes().begin(), m.axes().end())
+{}
+
+void GeoIndex::Serialize(SpravSerialize::GeoIndex& m) const {
+  m.mutable_x()->Add(x_.begin(), x_.end());
+  m.mutable_y()->Add(y_.begin(), y_.end());
+  m.mutable_z()->Add(z_.begin(), z_.end());
+  m.mutable_ids()->Add(ids_.begin(), ids_.end());
+  m.set_axes(string(axes_.begin(), axes_.end()));
+}
+
+GeoIndex::Found GeoIndex::FindNearest(Point point, size_t count, optional<double> radius) const {
+  if (count == 0 || ids_.empty()) {
+    return {};
+  }
+
+  const double max_chord = radius ? Geo::MetersToChord(*radius) : 2;
+  Search search{ToUnitVector(point), count, max_chord * max_chord, {}};
+  search.best.reserve(min(count, ids_.size()));
+  Find(0, ids_.size(), search);
+
+  sort_heap(search.best.begin(), search.best.end());
+  Found result;
+  result.reserve(search.best.size());
+  for (auto [dist2, id] : search.best) {
+    result.emplace_back(id, Geo::ChordToMeters(sqrt(dist2)));
+  }
+  return result;
+}
+
+size_t GeoIndex::Size() const {
+  return ids_.size();
+}
+
+size_t GeoIndex::GetMemoryUsage() const {
+  return Memory::GetHeapSize(x_) + Memory::GetHeapSize(y_) + Memory::GetHeapSize(z_)
+      + Memory::GetHeapSize(ids_) + Memory::GetHeapSize(axes_);
+}
+
+const vector<double>& GeoIndex::GetAxis(uint8_t axis) const {
+  return axis == 0 ? x_ : axis == 1 ? y_ : z_;
+}
+
+void GeoIndex::Find(size_t begin, size_t end, Search& search) const {
+  const auto [px, py, pz] = search.point;
+
+  if (end - begin <= LEAF_SIZE) {
+    // Independent lanes over contiguous arrays: the compiler vectorizes it
+    array<double, LEAF_SIZE> dist2;
+    const size_t size = end - begin;
+    for (size_t i = 0; i < size; ++i) {
+      const double dx = x_[begin + i] - px;
+      const double dy = y_[begin + i] - py;
+      const double dz = z_[begin + i] - pz;
+      dist2[i] = dx * dx + dy * dy + dz * dz;
+    }
+    for (size_t i = 0; i < size; ++i) {
+      search.Push(dist2[i], ids_[begin + i]);
+    }
+    return;
+  }
+
+  const size_t mid = begin + (end - begin) / 2;
+  const double dx = x_[mid] - px;
+  const double dy = y_[mid] - py;
+  const double dz = z_[mid] - pz;
+  search.Push(dx * dx + dy * dy + dz * dz, ids_[mid]);
+
+  const double diff = GetAxis(axes_[mid])[mid] - search.point[axes_[mid]];
+  const bool left_first = diff > 0;
+  Find(left_first ? begin : mid + 1, left_first ? mid : end, search);
+  if (diff * diff <= search.GetBound()) {
+    Find(left_first ? mid + 1 : begin, left_first ? end : mid, search);
+  }
+}
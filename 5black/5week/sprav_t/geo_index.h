@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "transport_catalog.pb.h"
+
+// KD-tree over points on the Earth's surface. Points are kept as unit
+// vectors, where chord length grows with the great-circle distance, so
+// nearest by chord is nearest on the sphere. The tree is implicit: every
+// node is a range of the coordinate arrays split at its middle element.
+class GeoIndex {
+ public:
+  struct Point {
+    double lat;
+    double lon;
+  };
+
+  // Nearest first: point id (its position in the input) and meters
+  using Found = std::vector<std::pair<size_t, double>>;
+
+  GeoIndex() = default;
+  GeoIndex(const std::vector<Point>& points);
+  GeoIndex(const SpravSerialize::GeoIndex& m);
+
+  void Serialize(SpravSerialize::GeoIndex& m) const;
+
+  // Up to count nearest points, only those within radius meters if given
+  Found FindNearest(Point point, size_t count, std::optional<double> radius = std::nullopt) const;
+
+  size_t Size() const;
+  size_t GetMemoryUsage() const;
+
+ private:
+  // Structure of arrays, so leaves are scanned with plain vector loops
+  std::vector<double> x_;
+  std::vector<double> y_;
+  std::vector<double> z_;
+  std::vector<uint32_t> ids_;
+  // Split axis of the node whose middle element is at the position
+  std::vector<uint8_t> axes_;
+
+  const std::vector<double>& GetAxis(uint8_t axis) const;
+
+  struct Search;
+  void Find(size_t begin, size_t end, Search& search) const;
+};
@@ -2,8 +2,10 @@
 
 #include <cstdlib>
 #include <deque>
+#include <utility>
 #include <vector>
 
+#include "memory_report.h"
 #include "transport_catalog.pb.h"
 
 template <typename It>
@@ -45,12 +47,16 @@ namespace Graph {
     DirectedWeightedGraph(const SpravSerialize::Graph& m);
 
     EdgeId AddEdge(const Edge& edge);
+    EdgeId AddEdge(Edge&& edge);
 
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
     const Edge& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
+    // Heap bytes of edges and incidence lists, without edge extras' own
+    size_t GetMemoryUsage() const;
+
     void Serialize(SpravSerialize::Graph& m);
 
   private:
@@ -79,6 +85,14 @@ namespace Graph {
     return id;
   }
 
+  template <typename Weight, typename Extra>
+  EdgeId DirectedWeightedGraph<Weight, Extra>::AddEdge(Edge&& edge) {
+    const EdgeId id = edges_.size();
+    incidence_lists_[edge.from].push_back(id);
+    edges_.push_back(std::move(edge));
+    return id;
+  }
+
   template <typename Weight, typename Extra>
   size_t DirectedWeightedGraph<Weight, Extra>::GetVertexCount() const {
     return incidence_lists_.size();
@@ -101,6 +115,15 @@ namespace Graph {
     return {std::begin(edges), std::end(edges)};
   }
 
+  template <typename Weight, typename Extra>
+  size_t DirectedWeightedGraph<Weight, Extra>::GetMemoryUsage() const {
+    size_t size = Memory::GetHeapSize(edges_) + Memory::GetHeapSize(incidence_lists_);
+    for (const auto& list : incidence_lists_) {
+      size += Memory::GetHeapSize(list);
+    }
+    return size;
+  }
+
   template <typename Weight, typename Extra>
   void DirectedWeightedGraph<Weight, Extra>::Serialize(SpravSerialize::Graph& m) {
     for (const auto& edge : edges_) {
@@ -1,24 +1,59 @@
 #include "json.h"
 
 #include <iomanip>
+#include <sstream>
+#include <stdexcept>
 
 using namespace std;
 
 namespace Json {
 
-  Node::Node(size_t v) : NodeBase(static_cast<int>(v)) {}
-  Node::Node(const char* s) : NodeBase(string(s)) {}
+  namespace {
 
-  Node LoadArray(istream& input) {
-    Array result;
+    void SkipChar(istream& input, char expected) {
+      char c;
+      if (!(input >> c) || c != expected) {
+        throw runtime_error(string("Json: expected '") + expected + "'");
+      }
+    }
+
+    // Loops over the array whose '[' is already read
+    template <typename Callback>
+    void ForEachItem(istream& input, Callback on_item) {
+      for (char c; input >> c && c != ']'; ) {
+        if (c != ',') {
+          input.putback(c);
+        }
+        on_item(LoadNode(input));
+      }
+    }
 
-    for (char c; input >> c && c != ']'; ) {
-      if (c != ',') {
-        input.putback(c);
+    // Loops over the dict whose '{' is already read, on_value must
+    // consume the value
+    template <typename Callback>
+    void ForEachKey(istream& input, Callback on_value) {
+      for (char c; input >> c && c != '}'; ) {
+        if (c == ',') {
+          input >> c;
+        }
+
+        string key;
+        getline(input, key, '"');
+        input >> c;
+        on_value(move(key), input);
       }
-      result.push_back(LoadNode(input));
     }
 
+  }
+
+  Node::Node(size_t v) : NodeBase(static_cast<int>(v)) {}
+  Node::Node(const char* s) : NodeBase(string(s)) {}
+
+  Node LoadArray(istream& input) {
+    Array result;
+    ForEachItem(input, [&result](Node node) {
+      result.push_back(move(node));
+    });
     return Node(move(result));
   }
 
@@ -62,17 +97,9 @@ namespace Json {
 
   Node LoadDict(istream& input) {
     Dict result;
-
-    for (char c; input >> c && c != '}'; ) {
-      if (c == ',') {
-        input >> c;
-      }
-
-      string key = LoadString(input).AsString();
-      input >> c;
+    ForEachKey(input, [&result](string key, istream& input) {
       result.emplace(move(key), LoadNode(input));
-    }
-
+    });
     return Node(move(result));
   }
 
@@ -99,6 +126,16 @@ namespace Json {
     return Document{LoadNode(input)};
   }
 
+  void LoadDictItems(istream& input, const function<void(string, istream&)>& on_value) {
+    SkipChar(input, '{');
+    ForEachKey(input, on_value);
+  }
+
+  void LoadArrayItems(istream& input, const function<void(Node)>& on_item) {
+    SkipChar(input, '[');
+    ForEachItem(input, on_item);
+  }
+
   template <>
   void PrintValue<string>(const string& value, ostream& output) {
     output << quoted(value);
@@ -139,6 +176,17 @@ namespace Json {
     output << '}';
   }
 
+  template <>
+  void PrintValue<Raw>(const Raw& raw, std::ostream& output) {
+    output.write(raw.text->data(), raw.text->size());
+  }
+
+  Raw MakeRaw(const Node& node) {
+    ostringstream os;
+    PrintNode(node, os);
+    return {make_shared<const string>(os.str())};
+  }
+
   void PrintNode(const Json::Node& node, ostream& output) {
     visit([&output](const auto& value) { PrintValue(value, output); },
           node.GetBase());
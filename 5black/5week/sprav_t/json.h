@@ -1,7 +1,9 @@
 #pragma once
 
+#include <functional>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <variant>
@@ -13,7 +15,13 @@ namespace Json {
   using Dict = std::map<std::string, Node>;
   using Array = std::vector<Node>;
 
-  using NodeBase = std::variant<Array, Dict, bool, int, double, std::string>;
+  // Already serialized JSON, shared between nodes and printed as is:
+  // heavy payloads are neither copied nor escaped again
+  struct Raw {
+    std::shared_ptr<const std::string> text;
+  };
+
+  using NodeBase = std::variant<Array, Dict, bool, int, double, std::string, Raw>;
 
   class Node : NodeBase {
   public:
@@ -51,8 +59,17 @@ namespace Json {
 
   Document Load(std::istream& input);
 
+  // Streaming loading: callbacks get every element as soon as it is
+  // parsed, so the whole document is never kept in memory. on_value gets
+  // the input positioned at the value and has to consume it, with
+  // LoadNode or one more streaming call.
+  void LoadDictItems(std::istream& input, const std::function<void(std::string, std::istream&)>& on_value);
+  void LoadArrayItems(std::istream& input, const std::function<void(Node)>& on_item);
+
   void PrintNode(const Node& node, std::ostream& output);
 
+  Raw MakeRaw(const Node& node);
+
   template <typename Value>
   void PrintValue(const Value& value, std::ostream& output) {
     output << value;
@@ -70,6 +87,9 @@ namespace Json {
   template <>
   void PrintValue<Dict>(const Dict& dict, std::ostream& output);
 
+  template <>
+  void PrintValue<Raw>(const Raw& raw, std::ostream& output);
+
   void Print(const Document& document, std::ostream& output);
 
 }
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+// Thread-safe LRU cache bounded by the summed size of its entries.
+// Entry size is given by size_func, so the bound may be in bytes.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+ public:
+  using SizeFunc = std::function<size_t(const Key&, const Value&)>;
+
+  struct Stats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t count = 0;
+    size_t size = 0;
+  };
+
+  LruCache(size_t max_size, SizeFunc size_func)
+    : max_size_(max_size)
+    , size_func_(std::move(size_func))
+  {}
+
+  std::optional<Value> Get(const Key& key) {
+    std::lock_guard g(m_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+      ++stats_.misses;
+      return std::nullopt;
+    }
+    ++stats_.hits;
+    items_.splice(items_.begin(), items_, it->second);
+    return it->second->value;
+  }
+
+  void Put(const Key& key, Value value) {
+    const size_t size = size_func_(key, value);
+    if (size > max_size_) {
+      return;
+    }
+
+    std::lock_guard g(m_);
+    if (auto it = index_.find(key); it != index_.end()) {
+      Erase(it->second);
+    }
+    while (stats_.size + size > max_size_) {
+      Erase(std::prev(items_.end()));
+      ++stats_.evictions;
+    }
+
+    items_.push_front({key, std::move(value), size});
+    index_.emplace(key, items_.begin());
+    stats_.size += size;
+    ++stats_.count;
+  }
+
+  void Clear() {
+    std::lock_guard g(m_);
+    index_.clear();
+    items_.clear();
+    stats_.count = 0;
+    stats_.size = 0;
+  }
+
+  Stats GetStats() const {
+    std::lock_guard g(m_);
+    return stats_;
+  }
+
+ private:
+  struct Item {
+    Key key;
+    Value value;
+    size_t size;
+  };
+  using Items = std::list<Item>;
+
+  const size_t max_size_;
+  const SizeFunc size_func_;
+
+  mutable std::mutex m_;
+  Items items_;
+  std::unordered_map<Key, typename Items::iterator, Hash> index_;
+  Stats stats_;
+
+  void Erase(typename Items::iterator it) {
+    stats_.size -= it->size;
+    --stats_.count;
+    index_.erase(it->key);
+    items_.erase(it);
+  }
+};
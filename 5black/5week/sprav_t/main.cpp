@@ -9,23 +9,25 @@
 using namespace std;
 
 void Do(std::string_view mode) {
-  LOG_DURATION("Do");
+  TRACE("Do");
   SpravPtr sprav = make_shared<Sprav>();
   if (mode == "make_base") {
     SpravIO(sprav, SpravIO::Mode::MAKE_BASE, cout).Process(cin);
+  } else if (mode == "update_base") {
+    SpravIO(sprav, SpravIO::Mode::UPDATE_BASE, cout).Process(cin);
   } else if (mode == "process_requests") {
     SpravIO(sprav, SpravIO::Mode::PROCESS_REQUESTS, cout).Process(cin);
   }
 
   {
-    LOG_DURATION("Do: sprav destruction");
+    TRACE("Do: sprav destruction");
     sprav.reset();
   }
 }
 
 int main(int argc, const char* argv[]) {
   if (argc != 2) {
-    cerr << "Usage: transport_catalog_part_o [make_base|process_requests]\n";
+    cerr << "Usage: transport_catalog_part_o [make_base|update_base|process_requests]\n";
     return 5;
   }
 
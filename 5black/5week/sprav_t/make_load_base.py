@@ -0,0 +1,293 @@
+import argparse
+import copy
+import json
+import math
+import random
+
+parser = argparse.ArgumentParser(description='Generating synthetic city load')
+parser.add_argument('--seed', type=int, default=1)
+parser.add_argument('--stops', type=int, default=1000)
+parser.add_argument('--buses', type=int, default=100)
+parser.add_argument('--bus-stops-mean', type=float, default=10)
+parser.add_argument('--bus-stops-sigma', type=float, default=5)
+parser.add_argument('--roundtrip-share', type=float, default=0.5)
+parser.add_argument('--companies', type=int, default=100)
+parser.add_argument('--rubrics', type=int, default=10)
+parser.add_argument('--requests', type=int, default=1000)
+parser.add_argument('--mix', default='Bus=1,Stop=1,Route=4,RouteToCompany=2,FindCompanies=1',
+                    help='request type weights, e.g. Route=4,Map=0')
+parser.add_argument('--file', default='data_load.bin', help='serialization file')
+parser.add_argument('--prefix', default='load', help='output files prefix')
+args = parser.parse_args()
+
+r = random.Random(args.seed)
+
+# Stops are spread over a square of city size, so buses can walk between
+# close stops like real lines do
+city_lat = 55.75
+city_lon = 37.6
+city_size = 0.2 * math.sqrt(max(args.stops, 1) / 1000)
+
+settings_make = {
+    "serialization_settings": {
+        "file": args.file
+    },
+    "routing_settings": {
+        "bus_wait_time": 2,
+        "bus_velocity": 30,
+        "pedestrian_velocity": 4
+    },
+    "render_settings": {
+        "width": 1500,
+        "height": 950,
+        "padding": 50,
+        "outer_margin": 150,
+        "stop_radius": 3,
+        "company_radius": 5,
+        "line_width": 10,
+        "company_line_width": 2,
+        "bus_label_font_size": 18,
+        "bus_label_offset": [
+            7,
+            15
+        ],
+        "stop_label_font_size": 13,
+        "stop_label_offset": [
+            7,
+            -3
+        ],
+        "underlayer_color": [
+            255,
+            255,
+            255,
+            0.85
+        ],
+        "underlayer_width": 3,
+        "color_palette": [
+            "red",
+            "green",
+            "blue",
+            "brown",
+            "orange"
+        ],
+        "layers": [
+            "bus_lines",
+            "company_lines",
+            "bus_labels",
+            "stop_points",
+            "company_points",
+            "stop_labels",
+            "company_labels"
+        ]
+    }
+}
+
+settings_process = {
+    "serialization_settings": {
+        "file": args.file
+    }
+}
+
+days = ["MONDAY", "TUESDAY", "WEDNESDAY", "THURSDAY", "FRIDAY", "SATURDAY", "SUNDAY"]
+
+
+def stop_name(n):
+    return "stop" + str(n)
+
+
+def bus_name(n):
+    return "bus" + str(n)
+
+
+def rubric_name(n):
+    return "rubric" + str(n)
+
+
+def geo_distance(lhs, rhs):
+    lat = math.radians((lhs["lat"] + rhs["lat"]) / 2)
+    d_lat = lhs["lat"] - rhs["lat"]
+    d_lon = (lhs["lon"] - rhs["lon"]) * math.cos(lat)
+    return math.sqrt(d_lat ** 2 + d_lon ** 2) * 111200
+
+
+stops = []
+for n in range(args.stops):
+    stops.append({
+        "lat": city_lat + r.uniform(-city_size, city_size),
+        "lon": city_lon + r.uniform(-city_size, city_size),
+        "dists": {}
+    })
+
+# Buckets of a coarse grid let bus lines pick the next stop nearby
+grid_size = max(1, int(math.sqrt(args.stops / 4)))
+grid = {}
+
+
+def grid_cell(stop):
+    x = int((stop["lat"] - city_lat + city_size) / (2 * city_size) * grid_size)
+    y = int((stop["lon"] - city_lon + city_size) / (2 * city_size) * grid_size)
+    return min(x, grid_size - 1), min(y, grid_size - 1)
+
+
+for n, stop in enumerate(stops):
+    grid.setdefault(grid_cell(stop), []).append(n)
+
+
+def next_stop(s_from, used):
+    x, y = grid_cell(stops[s_from])
+    candidates = []
+    for dx in (-1, 0, 1):
+        for dy in (-1, 0, 1):
+            candidates.extend(grid.get((x + dx, y + dy), []))
+    candidates = [c for c in candidates if c not in used]
+    if not candidates:
+        candidates = [c for c in range(args.stops) if c not in used]
+    return r.choice(candidates) if candidates else None
+
+
+def set_distance(s_from, s_to):
+    if stop_name(s_to) not in stops[s_from]["dists"]:
+        dist = geo_distance(stops[s_from], stops[s_to])
+        stops[s_from]["dists"][stop_name(s_to)] = max(1, int(dist * r.uniform(1.1, 1.5)))
+
+
+base_buses = []
+for n in range(args.buses):
+    count = int(r.gauss(args.bus_stops_mean, args.bus_stops_sigma))
+    count = min(max(2, count), args.stops)
+    is_roundtrip = r.random() < args.roundtrip_share
+
+    line = [r.randrange(args.stops)]
+    used = set(line)
+    while len(line) < count:
+        s = next_stop(line[-1], used)
+        if s is None:
+            break
+        line.append(s)
+        used.add(s)
+    if is_roundtrip:
+        line.append(line[0])
+
+    for s_from, s_to in zip(line, line[1:]):
+        set_distance(s_from, s_to)
+        if not is_roundtrip:
+            set_distance(s_to, s_from)
+
+    base_buses.append({
+        "type": "Bus",
+        "name": bus_name(n),
+        "stops": [stop_name(s) for s in line],
+        "is_roundtrip": is_roundtrip
+    })
+
+base_stops = []
+for n, stop in enumerate(stops):
+    base_stops.append({
+        "type": "Stop",
+        "name": stop_name(n),
+        "latitude": stop["lat"],
+        "longitude": stop["lon"],
+        "road_distances": stop["dists"]
+    })
+
+
+def make_working_time():
+    kind = r.random()
+    if kind < 0.2:
+        return {}
+    if kind < 0.6:
+        start = r.randrange(6, 11) * 60
+        return {"intervals": [{"day": "EVERYDAY", "minutes_from": start, "minutes_to": start + r.randrange(8, 13) * 60}]}
+    intervals = []
+    for day in r.sample(days, r.randrange(1, 8)):
+        start = r.randrange(0, 12) * 60
+        intervals.append({"day": day, "minutes_from": start, "minutes_to": start + r.randrange(1, 12) * 60})
+    return {"intervals": intervals}
+
+
+rubrics = {str(n + 1): {"name": rubric_name(n)} for n in range(args.rubrics)}
+companies = []
+for n in range(args.companies):
+    nearby = r.sample(range(args.stops), min(args.stops, r.randrange(1, 4)))
+    anchor = stops[nearby[0]]
+    company = {
+        "names": [{"value": "company" + str(n)}],
+        "rubrics": [int(k) for k in r.sample(sorted(rubrics), min(len(rubrics), r.randrange(1, 3)))],
+        "address": {
+            "coords": {
+                "lat": str(anchor["lat"] + r.uniform(-0.002, 0.002)),
+                "lon": str(anchor["lon"] + r.uniform(-0.002, 0.002))
+            }
+        },
+        "nearby_stops": [{"name": stop_name(s), "meters": r.randrange(50, 1000)} for s in nearby],
+        "phones": [{"type": "PHONE", "country_code": "7", "local_code": "495", "number": str(r.randrange(1000000, 10000000))}]
+    }
+    working_time = make_working_time()
+    if working_time:
+        company["working_time"] = working_time
+    companies.append(company)
+
+make = copy.deepcopy(settings_make)
+make["base_requests"] = base_stops + base_buses
+make["yellow_pages"] = {"rubrics": rubrics, "companies": companies}
+with open(args.prefix + "_make_base.in.json", "w") as f:
+    f.write(json.dumps(make))
+
+
+def random_stop():
+    return stop_name(r.randrange(args.stops))
+
+
+def random_query():
+    if rubrics and r.random() < 0.7:
+        return {"rubrics": [rubric_name(r.randrange(args.rubrics))]}
+    return {"names": ["company" + str(r.randrange(max(1, args.companies)))]}
+
+
+def make_request(request_type):
+    if request_type == "Bus":
+        return {"type": "Bus", "name": bus_name(r.randrange(args.buses))}
+    if request_type == "Stop":
+        return {"type": "Stop", "name": random_stop()}
+    if request_type == "Route":
+        return {"type": "Route", "from": random_stop(), "to": random_stop()}
+    if request_type == "RouteToCompany":
+        return {"type": "RouteToCompany", "from": random_stop(), "companies": random_query(),
+                "datetime": [r.randrange(7), r.randrange(24), r.randrange(60)]}
+    if request_type == "FindCompanies":
+        return random_query() | {"type": "FindCompanies"}
+    if request_type == "Reachable":
+        return {"type": "Reachable", "from": random_stop(), "max_time": r.randrange(10, 60)}
+    if request_type == "RouteMatrix":
+        return {"type": "RouteMatrix", "from": [random_stop() for _ in range(10)], "to": [random_stop() for _ in range(10)]}
+    if request_type == "NearestStops":
+        return {"type": "NearestStops", "latitude": city_lat + r.uniform(-city_size, city_size),
+                "longitude": city_lon + r.uniform(-city_size, city_size), "count": 5}
+    if request_type == "SuggestCompanies":
+        # What the search box sends after a few keystrokes, now and then with a typo
+        name = "company" + str(r.randrange(max(1, args.companies)))
+        query = list(name[:r.randrange(1, len(name) + 1)])
+        if len(query) > 3 and r.random() < 0.3:
+            query[r.randrange(len(query))] = r.choice("abcdefghijklmnopqrstuvwxyz")
+        return {"type": "SuggestCompanies", "query": "".join(query), "count": 5}
+    if request_type == "Map":
+        return {"type": "Map"}
+    raise ValueError("Unknown request type " + request_type)
+
+
+mix = []
+for item in args.mix.split(","):
+    request_type, weight = item.split("=")
+    mix.append((request_type, float(weight)))
+
+stat_requests = []
+for n in range(args.requests):
+    request_type = r.choices([t for t, _ in mix], weights=[w for _, w in mix])[0]
+    request = make_request(request_type)
+    request["id"] = n + 1
+    stat_requests.append(request)
+
+process = copy.deepcopy(settings_process)
+process["stat_requests"] = stat_requests
+with open(args.prefix + "_process_requests.in.json", "w") as f:
+    f.write(json.dumps(process))
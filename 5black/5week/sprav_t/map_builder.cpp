@@ -4,6 +4,10 @@
 #include "sprav_mapper.h"
 #include "point_projector.h"
 
+#include <sstream>
+
+using namespace std;
+
 const unordered_map<MapLayerType, void (Builder::*)(const Sprav::Route*)> Builder::DRAW_ACTIONS = {
     {MapLayerType::BUS_LINES, &Builder::DrawBusLines},
     {MapLayerType::BUS_LABELS, &Builder::DrawBusEndPoints},
@@ -25,9 +29,9 @@ Builder::Builder(const SpravMapper& mapper, std::optional<Svg::Document> doc)
 
 void Builder::DrawBusLines(const Sprav::Route* route) {
   if (route) {
-    for (auto part : *route) {
+    for (const auto& part : *route) {
       if (part.type == RoutePartType::RIDE_BUS) {
-        DrawLine(bus_lines_palette_[part.name], part.stops);
+        DrawLine(bus_lines_palette_[part.name], route->GetStops(part));
       }
     }
   } else {
@@ -40,9 +44,9 @@ void Builder::DrawBusLines(const Sprav::Route* route) {
 
 void Builder::DrawStops(const Sprav::Route* route) {
   if (route) {
-    for (auto part : *route) {
+    for (const auto& part : *route) {
       if (part.type == RoutePartType::RIDE_BUS) {
-        for (auto stop_id : part.stops) {
+        for (auto stop_id : route->GetStops(part)) {
           DrawStop(mapper_.GetSprav()->GetStop(stop_id));
         }
       }
@@ -58,12 +62,12 @@ void Builder::DrawStopNames(const Sprav::Route* route) {
   if (route) {
     std::optional<size_t> last_stop_id;
     bool only_walk = true;
-    for (auto part : *route) {
+    for (const auto& part : *route) {
       if (part.type == RoutePartType::WAIT_BUS) {
         DrawStopName(*mapper_.GetSprav()->FindStop(part.name));
         only_walk = false;
       } else if (part.type == RoutePartType::RIDE_BUS) {
-        last_stop_id = *part.stops.rbegin();
+        last_stop_id = *prev(route->GetStops(part).end());
         only_walk = false;
       } else if (part.type == RoutePartType::WALK_TO_COMPANY && only_walk) {
         DrawStopName(*mapper_.GetSprav()->FindStop(part.name));
@@ -81,14 +85,15 @@ void Builder::DrawStopNames(const Sprav::Route* route) {
 
 void Builder::DrawBusEndPoints(const Sprav::Route* route) {
   if (route) {
-    for (auto part : *route) {
+    for (const auto& part : *route) {
       if (part.type == RoutePartType::RIDE_BUS) {
         const Bus& bus = *mapper_.GetSprav()->FindBus(part.name);
         size_t first_end_stop_id = *begin(bus.stops);
         size_t last_end_stop_id = *rbegin(bus.stops);
 
-        size_t first_id = *part.stops.begin();
-        size_t last_id = *part.stops.rbegin();
+        const auto stops = route->GetStops(part);
+        size_t first_id = *stops.begin();
+        size_t last_id = *prev(stops.end());
         if (first_id == first_end_stop_id || first_id == last_end_stop_id) {
           DrawBusEndPoint(bus_lines_palette_[part.name], bus, mapper_.GetSprav()->GetStop(first_id));
         }
@@ -119,7 +124,7 @@ void Builder::DrawCompanyLines(const Sprav::Route* route) {
     return;
   }
 
-  for (auto part : *route) {
+  for (const auto& part : *route) {
     if (part.type == RoutePartType::WALK_TO_COMPANY) {
       const auto& stop = *mapper_.GetSprav()->FindStop(part.name);
       Svg::Polyline line;
@@ -139,7 +144,7 @@ void Builder::DrawCompanyPoints(const Sprav::Route* route) {
     return;
   }
 
-  for (auto part : *route) {
+  for (const auto& part : *route) {
     if (part.type == RoutePartType::WALK_TO_COMPANY) {
       doc_.Add(Svg::Circle{}
                   .SetCenter(mapper_.GetProjector()(part.company_id))
@@ -154,7 +159,7 @@ void Builder::DrawCompanyLabels(const Sprav::Route* route) {
     return;
   }
 
-  for (auto part : *route) {
+  for (const auto& part : *route) {
     if (part.type == RoutePartType::WALK_TO_COMPANY) {
       string name = mapper_.GetSprav()->GetPages()->GetCompanyFullName(part.company_id);
       DrawStopName(mapper_.GetProjector()(part.company_id), std::move(name));
@@ -193,19 +198,15 @@ void Builder::BuildBusLinesPalette() {
 }
 
 void Builder::DrawLineFull(const Svg::Color& line_color, const Bus& bus) {
-  std::list<size_t> stops;
-  for (const auto& stop_id : bus.stops) {
-    stops.push_back(stop_id);
-  }
+  std::vector<size_t> stops(bus.stops.begin(), bus.stops.end());
   if (!bus.is_roundtrip) {
-    for (auto it = ++rbegin(bus.stops); it != rend(bus.stops); ++it) {
-      stops.push_back(*it);
-    }
+    stops.insert(stops.end(), ++rbegin(bus.stops), rend(bus.stops));
   }
   DrawLine(line_color, stops);
 }
 
-void Builder::DrawLine(const Svg::Color& line_color, const std::list<size_t>& stops) {
+template <typename Stops>
+void Builder::DrawLine(const Svg::Color& line_color, const Stops& stops) {
   Svg::Polyline line;
   line.SetStrokeColor(line_color);
   line.SetStrokeWidth(mapper_.GetSettings().line_width);
@@ -38,7 +38,8 @@ class Builder {
   void BuildBusLinesPalette();
 
   void DrawLineFull(const Svg::Color& line_color, const Bus& bus);
-  void DrawLine(const Svg::Color& line_color, const std::list<size_t>& stops);
+  template <typename Stops>
+  void DrawLine(const Svg::Color& line_color, const Stops& stops);
 
   void DrawStop(const Stop& stop);
   void DrawStopName(const Stop& stop);
@@ -0,0 +1,67 @@
+#include "memory_report.h"
+
+#include <fstream>
+#include <iomanip>
+#include <limits>
+
+using namespace std;
+
+namespace {
+
+// Value of a "Name:   1234 kB" line of /proc/self/status
+size_t ReadStatusSize(const string& name) {
+  ifstream status("/proc/self/status");
+  for (string key; status >> key; ) {
+    if (key == name + ":") {
+      size_t kb = 0;
+      status >> kb;
+      return kb * 1024;
+    }
+    status.ignore(numeric_limits<streamsize>::max(), '\n');
+  }
+  return 0;
+}
+
+} // namespace
+
+size_t Memory::GetResidentSize() {
+  return ReadStatusSize("VmRSS");
+}
+
+size_t Memory::GetPeakResidentSize() {
+  return ReadStatusSize("VmHWM");
+}
+
+void MemoryReport::Add(string name, size_t count, size_t bytes) {
+  items_.push_back({move(name), count, bytes});
+}
+
+const vector<MemoryReport::Item>& MemoryReport::GetItems() const {
+  return items_;
+}
+
+size_t MemoryReport::GetTotalBytes() const {
+  size_t total = 0;
+  for (const auto& item : items_) {
+    total += item.bytes;
+  }
+  return total;
+}
+
+void MemoryReport::Print(ostream& os) const {
+  const auto flags = os.flags();
+  const auto precision = os.precision();
+
+  os << "subsystem,count,bytes,mb\n" << fixed << setprecision(3);
+  for (const auto& item : items_) {
+    os << item.name << "," << item.count << "," << item.bytes << "," << item.bytes / 1048576.0 << "\n";
+  }
+  const size_t total = GetTotalBytes();
+  os << "total,," << total << "," << total / 1048576.0 << "\n";
+  for (auto [name, bytes] : {pair{"rss", Memory::GetResidentSize()}, pair{"peak rss", Memory::GetPeakResidentSize()}}) {
+    os << name << ",," << bytes << "," << bytes / 1048576.0 << "\n";
+  }
+
+  os.flags(flags);
+  os.precision(precision);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Heap footprint estimates of standard containers as libstdc++ lays
+// them out: node containers pay for their links, hash tables also for
+// the bucket array. Elements' own heap memory is not included.
+namespace Memory {
+
+inline size_t GetHeapSize(const std::string& s) {
+  // Short strings live inside the object
+  return s.capacity() > 15 ? s.capacity() + 1 : 0;
+}
+
+template <typename T, typename A>
+size_t GetHeapSize(const std::vector<T, A>& v) {
+  return v.capacity() * sizeof(T);
+}
+
+template <typename T, typename A>
+size_t GetHeapSize(const std::deque<T, A>& d) {
+  return d.size() * sizeof(T);
+}
+
+template <typename T, typename A>
+size_t GetHeapSize(const std::list<T, A>& l) {
+  return l.size() * (sizeof(T) + 2 * sizeof(void*));
+}
+
+template <typename C>
+size_t GetTreeHeapSize(const C& c) {
+  return c.size() * (sizeof(typename C::value_type) + 4 * sizeof(void*));
+}
+
+template <typename K, typename C, typename A>
+size_t GetHeapSize(const std::set<K, C, A>& s) {
+  return GetTreeHeapSize(s);
+}
+
+template <typename K, typename V, typename C, typename A>
+size_t GetHeapSize(const std::map<K, V, C, A>& m) {
+  return GetTreeHeapSize(m);
+}
+
+template <typename C>
+size_t GetHashHeapSize(const C& c) {
+  return c.bucket_count() * sizeof(void*) + c.size() * (sizeof(typename C::value_type) + 2 * sizeof(void*));
+}
+
+template <typename K, typename H, typename E, typename A>
+size_t GetHeapSize(const std::unordered_set<K, H, E, A>& s) {
+  return GetHashHeapSize(s);
+}
+
+template <typename K, typename V, typename H, typename E, typename A>
+size_t GetHeapSize(const std::unordered_map<K, V, H, E, A>& m) {
+  return GetHashHeapSize(m);
+}
+
+// Resident and peak resident set sizes of the process in bytes, 0 where
+// /proc/self/status is not available
+size_t GetResidentSize();
+size_t GetPeakResidentSize();
+
+}
+
+// Bytes and object counts per catalog subsystem. The printed report ends
+// with the process RSS to compare the estimates against.
+class MemoryReport {
+ public:
+  struct Item {
+    std::string name;
+    size_t count;
+    size_t bytes;
+  };
+
+  void Add(std::string name, size_t count, size_t bytes);
+
+  const std::vector<Item>& GetItems() const;
+  size_t GetTotalBytes() const;
+
+  void Print(std::ostream& os) const;
+
+ private:
+  std::vector<Item> items_;
+};
@@ -0,0 +1,149 @@
+#include "name_index.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "memory_report.h"
+
+using namespace std;
+
+namespace {
+
+const size_t KEYS_PER_BUCKET = 4;
+const uint32_t MAX_SEED = 1u << 24;
+
+uint64_t Hash(string_view s, uint64_t seed) {
+  uint64_t h = 14695981039346656037ull ^ (seed * 0x9e3779b97f4a7c15ull);
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+}  // namespace
+
+NameIndex::NameIndex(const vector<string_view>& names) {
+  Build(names);
+}
+
+NameIndex::NameIndex(const SpravSerialize::NameIndex& m) {
+  ParseFrom(m);
+}
+
+void NameIndex::Serialize(SpravSerialize::NameIndex& m) const {
+  m.set_table(table_);
+  m.mutable_offsets()->Add(offsets_.begin(), offsets_.end());
+  m.mutable_seeds()->Add(seeds_.begin(), seeds_.end());
+  m.mutable_slots()->Add(slots_.begin(), slots_.end());
+}
+
+optional<size_t> NameIndex::Find(string_view name) const {
+  if (slots_.empty()) {
+    return nullopt;
+  }
+
+  const uint32_t seed = seeds_[Hash(name, 0) % seeds_.size()];
+  if (seed == 0) {
+    return nullopt;
+  }
+
+  const size_t id = slots_[Hash(name, seed) % slots_.size()];
+  if (GetName(id) != name) {
+    return nullopt;
+  }
+  return id;
+}
+
+string_view NameIndex::GetName(size_t id) const {
+  return string_view(table_).substr(offsets_[id], offsets_[id + 1] - offsets_[id]);
+}
+
+size_t NameIndex::Size() const {
+  return slots_.size();
+}
+
+size_t NameIndex::GetMemoryUsage() const {
+  return Memory::GetHeapSize(table_) + Memory::GetHeapSize(offsets_)
+      + Memory::GetHeapSize(seeds_) + Memory::GetHeapSize(slots_);
+}
+
+void NameIndex::Build(const vector<string_view>& names) {
+  const size_t count = names.size();
+
+  offsets_.reserve(count + 1);
+  offsets_.push_back(0);
+  for (auto name : names) {
+    table_.append(name);
+    offsets_.push_back(table_.size());
+  }
+
+  if (count == 0) {
+    return;
+  }
+
+  const size_t buckets_count = (count + KEYS_PER_BUCKET - 1) / KEYS_PER_BUCKET;
+  vector<vector<uint32_t>> buckets(buckets_count);
+  for (uint32_t id = 0; id < count; ++id) {
+    buckets[Hash(names[id], 0) % buckets_count].push_back(id);
+  }
+
+  vector<size_t> order(buckets_count);
+  iota(order.begin(), order.end(), 0);
+  stable_sort(order.begin(), order.end(), [&buckets](size_t lhs, size_t rhs) {
+    return buckets[lhs].size() > buckets[rhs].size();
+  });
+
+  seeds_.assign(buckets_count, 0);
+  slots_.assign(count, 0);
+  vector<bool> taken(count, false);
+  vector<size_t> candidate;
+
+  for (size_t bucket_id : order) {
+    const auto& bucket = buckets[bucket_id];
+    if (bucket.empty()) {
+      break;
+    }
+
+    uint32_t seed = 1;
+    for (;; ++seed) {
+      if (seed == MAX_SEED) {
+        throw runtime_error("Failed to build name index: duplicate names?");
+      }
+
+      candidate.clear();
+      bool ok = true;
+      for (auto id : bucket) {
+        const size_t slot = Hash(names[id], seed) % count;
+        if (taken[slot] || find(candidate.begin(), candidate.end(), slot) != candidate.end()) {
+          ok = false;
+          break;
+        }
+        candidate.push_back(slot);
+      }
+
+      if (ok) {
+        break;
+      }
+    }
+
+    seeds_[bucket_id] = seed;
+    for (size_t i = 0; i < bucket.size(); ++i) {
+      taken[candidate[i]] = true;
+      slots_[candidate[i]] = bucket[i];
+    }
+  }
+}
+
+void NameIndex::ParseFrom(const SpravSerialize::NameIndex& m) {
+  table_ = m.table();
+  offsets_.assign(m.offsets().begin(), m.offsets().end());
+  seeds_.assign(m.seeds().begin(), m.seeds().end());
+  slots_.assign(m.slots().begin(), m.slots().end());
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "transport_catalog.pb.h"
+
+// Minimal perfect hash (hash and displace) over a fixed set of names.
+// Names are kept in one contiguous table, so lookup is a single probe
+// followed by one comparison against the stored name.
+class NameIndex {
+ public:
+  NameIndex() = default;
+  NameIndex(const std::vector<std::string_view>& names);
+  NameIndex(const SpravSerialize::NameIndex& m);
+
+  void Serialize(SpravSerialize::NameIndex& m) const;
+
+  std::optional<size_t> Find(std::string_view name) const;
+  std::string_view GetName(size_t id) const;
+  size_t Size() const;
+  size_t GetMemoryUsage() const;
+
+ private:
+  std::string table_;
+  std::vector<uint32_t> offsets_;
+  std::vector<uint32_t> seeds_;
+  std::vector<uint32_t> slots_;
+
+  void Build(const std::vector<std::string_view>& names);
+  void ParseFrom(const SpravSerialize::NameIndex& m);
+};
@@ -9,7 +9,8 @@
 #include <stdexcept>
 #include <functional>
 
-#include "profile.h"
+#include "memory_report.h"
+#include "trace.h"
 
 using namespace std;
 using ::google::protobuf::util::JsonStringToMessage;
@@ -46,6 +47,11 @@ bool Match(const YellowPages::Phone& phone, const YellowPages::Phone& tmpl) {
   return tmpl.number() == phone.number();
 }
 
+// Static rank of a company in suggestions: richer entries first
+uint32_t GetSuggestScore(const YellowPages::Company& c) {
+  return c.phones_size() + c.urls_size() + c.nearby_stops_size() + c.rubrics_size();
+}
+
 }  // namespace
 
 Pages::Pages(const Json::Dict& dict) {
@@ -57,13 +63,13 @@ Pages::Pages(const Json::Dict& dict) {
     err_ss << "Failed to parse " << quoted(ss.str()) << " as yellow pages database: " << status.ToString();
     throw runtime_error(err_ss.str());
   }
-  db_.CopyFrom(db);
+  db_.Swap(&db);
 
   BuildIndex();
 }
 
-Pages::Pages(const SpravSerialize::Pages& m) {
-  db_.CopyFrom(m.db());
+Pages::Pages(SpravSerialize::Pages&& m) {
+  db_.Swap(m.mutable_db());
 
   for (auto& [name, id] : m.rubrics_projection()) {
     rubrics_projection_.insert({name, id});
@@ -72,6 +78,8 @@ Pages::Pages(const SpravSerialize::Pages& m) {
   for (auto& [id, wtime] : m.company_working_times()) {
     company_working_times_.emplace(id, wtime);
   }
+
+  suggest_index_ = SuggestIndex(m.suggest_index());
 }
 
 void Pages::Serialize(SpravSerialize::Pages& m) {
@@ -84,10 +92,12 @@ void Pages::Serialize(SpravSerialize::Pages& m) {
   for (auto& [id, wtime] : company_working_times_) {
     wtime.Serialize(m.mutable_company_working_times()->operator[](id));
   }
+
+  suggest_index_.Serialize(*m.mutable_suggest_index());
 }
 
 void Pages::BuildIndex() {
-  LOG_DURATION("Pages::BuildIndex");
+  TRACE("Pages::BuildIndex");
 
   for (auto& r : db_.rubrics()) {
     rubrics_projection_[r.second.name()] = r.first;
@@ -98,6 +108,19 @@ void Pages::BuildIndex() {
     auto& c = db_.companies()[id];
     company_working_times_.emplace(id, WorkingTime(c.working_time()));
   }
+
+  // Every name counts: main ones, synonyms and short ones
+  vector<SuggestIndex::Entry> entries;
+  vector<uint32_t> scores;
+  scores.reserve(companies_size);
+  for (size_t id = 0; id < companies_size; ++id) {
+    auto& c = db_.companies()[id];
+    for (auto& n : c.names()) {
+      entries.push_back({n.value(), static_cast<uint32_t>(id)});
+    }
+    scores.push_back(GetSuggestScore(c));
+  }
+  suggest_index_ = SuggestIndex(entries, move(scores));
 }
 
 const YellowPages::Company& Pages::operator[](size_t id) const {
@@ -112,6 +135,18 @@ size_t Pages::Size() const {
   return db_.companies().size();
 }
 
+size_t Pages::GetMemoryUsage() const {
+  size_t size = db_.SpaceUsedLong() - sizeof(db_)
+      + Memory::GetHeapSize(rubrics_projection_) + Memory::GetHeapSize(company_working_times_);
+  for (const auto& [name, _] : rubrics_projection_) {
+    size += Memory::GetHeapSize(name);
+  }
+  for (const auto& [_, working_time] : company_working_times_) {
+    size += working_time.GetMemoryUsage();
+  }
+  return size + suggest_index_.GetMemoryUsage();
+}
+
 const std::string& Pages::GetCompanyMainName(size_t id) const {
   auto& c = db_.companies()[id];
   for (auto& n : c.names()) {
@@ -218,3 +253,7 @@ Pages::Companies Pages::Process(const YellowPages::Query& query) const {
 
   return result;
 }
+
+SuggestIndex::Found Pages::Suggest(string_view query, size_t count, size_t max_distance) const {
+  return suggest_index_.Suggest(query, count, max_distance);
+}
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <optional>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -10,6 +11,7 @@
 #include "database_queries.pb.h"
 #include "hash_extra.h"
 #include "json.h"
+#include "suggest_index.h"
 #include "working_time.h"
 
 class Pages {
@@ -23,7 +25,8 @@ class Pages {
  public:
   Pages() = default;
   Pages(const Json::Dict& dict);
-  Pages(const SpravSerialize::Pages& m);
+  // Takes the database over
+  Pages(SpravSerialize::Pages&& m);
   void Serialize(SpravSerialize::Pages& m);
 
   void BuildIndex();
@@ -31,17 +34,20 @@ class Pages {
   const YellowPages::Company& operator[](size_t id) const;
   const YellowPages::Company& Get(size_t id) const;
   size_t Size() const;
+  size_t GetMemoryUsage() const;
   const std::string& GetCompanyMainName(size_t id) const;
   std::string GetCompanyFullName(size_t id) const;
   std::optional<double> GetWaitTime(size_t id, const Time& current_time) const;
 
   Companies Process(const YellowPages::Query& query) const;
+  SuggestIndex::Found Suggest(std::string_view query, size_t count, size_t max_distance) const;
 
  private:
   YellowPages::Database db_;
 
   RubricsProjection rubrics_projection_;
   CompanyWorkingTimes company_working_times_;
+  SuggestIndex suggest_index_;
 
   void ParseFrom(const SpravSerialize::Pages& m);
 };
@@ -1,5 +1,6 @@
 #include "point_projector.h"
 
+#include "memory_report.h"
 #include "sprav_mapper.h"
 
 using namespace std;
@@ -47,6 +48,17 @@ void PointProjector::ParseFrom(const SpravSerialize::PointProjector& m) {
   }
 }
 
+size_t PointProjector::GetMemoryUsage() const {
+  size_t size = Memory::GetHeapSize(companies_) + Memory::GetHeapSize(buses_)
+      + Memory::GetHeapSize(moved_coords_) + Memory::GetHeapSize(adjacent_stops_)
+      + Memory::GetHeapSize(x_compress_data_) + Memory::GetHeapSize(x_compress_map_)
+      + Memory::GetHeapSize(y_compress_data_) + Memory::GetHeapSize(y_compress_map_);
+  for (const auto& [_, stops] : adjacent_stops_) {
+    size += Memory::GetHeapSize(stops);
+  }
+  return size;
+}
+
 void PointProjector::Serialize(SpravSerialize::PointProjector& m) const {
   m.set_stops_id_bound(stops_id_bound_);
   m.set_x_step(x_step);
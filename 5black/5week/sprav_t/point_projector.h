@@ -47,6 +47,8 @@ public:
   Svg::Point operator()(const Stop& s) const;
   Svg::Point operator()(size_t company_id) const;
 
+  size_t GetMemoryUsage() const;
+
 private:
   const SpravMapper& mapper_;
   size_t stops_id_bound_;
@@ -1,10 +1,71 @@
 #pragma once
 
+#include <charconv>
+#include <cstring>
 #include <istream>
-#include <string>
 #include <optional>
-#include <functional>
-#include <utility>
+#include <string_view>
+#include <vector>
+
+// Reads the stream in large blocks and finds line ends with memchr, which
+// libc vectorizes, so lines come as views into the block instead of fresh
+// strings. It reads ahead: sections of one stream must share a scanner.
+class LineScanner {
+ public:
+  static const size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+
+  explicit LineScanner(std::istream& input, size_t block_size = DEFAULT_BLOCK_SIZE)
+    : input_(input)
+    , buffer_(block_size)
+  {}
+
+  // Next line without its '\n', nullopt at the end of the input. The view
+  // is valid until the next call.
+  std::optional<std::string_view> NextLine() {
+    for (;;) {
+      const char* data = buffer_.data();
+      if (const void* eol = std::memchr(data + begin_, '\n', end_ - begin_)) {
+        const size_t pos = static_cast<const char*>(eol) - data;
+        std::string_view line(data + begin_, pos - begin_);
+        begin_ = pos + 1;
+        return line;
+      }
+      if (eof_) {
+        if (begin_ == end_) {
+          return std::nullopt;
+        }
+        std::string_view line(data + begin_, end_ - begin_);
+        begin_ = end_;
+        return line;
+      }
+      Fill();
+    }
+  }
+
+ private:
+  std::istream& input_;
+  std::vector<char> buffer_;
+  size_t begin_ = 0;
+  size_t end_ = 0;
+  bool eof_ = false;
+
+  // Moves the unfinished line to the front, growing the buffer if the
+  // line takes all of it, and reads after it
+  void Fill() {
+    const size_t tail = end_ - begin_;
+    if (tail == buffer_.size()) {
+      buffer_.resize(buffer_.size() * 2);
+    }
+    std::memmove(buffer_.data(), buffer_.data() + begin_, tail);
+    begin_ = 0;
+    end_ = tail;
+
+    input_.read(buffer_.data() + end_, buffer_.size() - end_);
+    const size_t read = input_.gcount();
+    end_ += read;
+    eof_ = read == 0;
+  }
+};
 
 class InputReader {
  public:
@@ -15,36 +76,51 @@ class InputReader {
     return *this;
   }
 
+  // Calls callback(std::string_view) for every non-empty line. With the
+  // counter, the first line tells how many lines follow.
   template <typename Callback>
-  InputReader& SetCallback(Callback cb) {
-    callback_.emplace(std::move(cb));
-    return *this;
-  }
-
-  InputReader& Process(std::istream& s) {
+  InputReader& Process(LineScanner& scanner, Callback callback) {
     if (use_counter_) {
-      int count;
-      std::string line;
-      s >> count;
-      getline(s, line);
+      int count = ReadCount(scanner);
       while (count-- > 0) {
-        getline(s, line);
-        if (!line.empty() && callback_) {
-          callback_.value()(std::move(line));
+        auto line = scanner.NextLine();
+        if (!line) {
+          break;
+        }
+        if (!line->empty()) {
+          callback(*line);
         }
       }
     } else {
-      std::string line;
-      while (getline(s, line)) {
-        if (!line.empty() && callback_) {
-          callback_.value()(std::move(line));
+      while (auto line = scanner.NextLine()) {
+        if (!line->empty()) {
+          callback(*line);
         }
       }
     }
     return *this;
   }
 
+  template <typename Callback>
+  InputReader& Process(std::istream& s, Callback callback) {
+    LineScanner scanner(s);
+    return Process(scanner, callback);
+  }
+
  private:
   bool use_counter_ = true;
-  std::optional<std::function<void(std::string)>> callback_;
-};
\ No newline at end of file
+
+  // Skips blank lines, the rest of the count line is ignored
+  static int ReadCount(LineScanner& scanner) {
+    while (auto line = scanner.NextLine()) {
+      const size_t pos = line->find_first_not_of(" \t\r");
+      if (pos == std::string_view::npos) {
+        continue;
+      }
+      int count = 0;
+      std::from_chars(line->data() + pos, line->data() + line->size(), count);
+      return count;
+    }
+    return 0;
+  }
+};
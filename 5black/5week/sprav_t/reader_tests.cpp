@@ -10,10 +10,9 @@ void Helper(InputReader& reader, const string& input, vector<string> expected) {
   vector<string> result;
   istringstream is(input);
 
-  reader.SetCallback([&result](string line) {
-    result.emplace_back(move(line));
+  reader.Process(is, [&result](string_view line) {
+    result.emplace_back(line);
   });
-  reader.Process(is);
   ASSERT_EQUAL(result, expected);
 }
 
@@ -64,9 +63,34 @@ void WOCounter() {
     {"a", "b"});
 }
 
+
+void SharedScanner() {
+  // Blocks smaller than lines make the scanner refill and grow
+  istringstream is(
+    "2\n"
+    "first line\n"
+    "\n"
+    "1\n"
+    "second section line\n"
+    "rest");
+  LineScanner scanner(is, 4);
+
+  vector<string> result;
+  auto collect = [&result](string_view line) {
+    result.emplace_back(line);
+  };
+  InputReader().Process(scanner, collect);
+  ASSERT_EQUAL(result, vector<string>({"first line"}));
+  InputReader().Process(scanner, collect);
+  ASSERT_EQUAL(result, vector<string>({"first line", "second section line"}));
+  InputReader().SetUseCounter(false).Process(scanner, collect);
+  ASSERT_EQUAL(result, vector<string>({"first line", "second section line", "rest"}));
+}
+
 }
 
 void TestInputReader(TestRunner& tr) {
   RUN_TEST(tr, InputReaderTests::WithCounter);
   RUN_TEST(tr, InputReaderTests::WOCounter);
+  RUN_TEST(tr, InputReaderTests::SharedScanner);
 }
\ No newline at end of file
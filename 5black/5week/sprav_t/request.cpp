@@ -7,14 +7,36 @@
 #include "request_base_stop.h"
 #include "request_find.h"
 #include "request_map.h"
+#include "request_nearest_stops.h"
+#include "request_reachable.h"
 #include "request_route.h"
+#include "request_route_matrix.h"
 #include "request_route_to_company.h"
 #include "request_stat_bus.h"
 #include "request_stat_stop.h"
+#include "request_suggest.h"
 #include "string_view_utils.h"
 
 using namespace std;
 
+string_view ToString(RequestType type) {
+  switch (type) {
+    case RequestType::BASE_BUS: return "BaseBus";
+    case RequestType::BASE_STOP: return "BaseStop";
+    case RequestType::STAT_BUS: return "Bus";
+    case RequestType::STAT_STOP: return "Stop";
+    case RequestType::ROUTE: return "Route";
+    case RequestType::ROUTE_TO_COMPANY: return "RouteToCompany";
+    case RequestType::MAP: return "Map";
+    case RequestType::FIND_COMPANIES: return "FindCompanies";
+    case RequestType::REACHABLE: return "Reachable";
+    case RequestType::ROUTE_MATRIX: return "RouteMatrix";
+    case RequestType::NEAREST_STOPS: return "NearestStops";
+    case RequestType::SUGGEST_COMPANIES: return "SuggestCompanies";
+  }
+  return "Unknown";
+}
+
 RequestPtr MakeBaseRequest(const Json::Node& doc) {
   auto& dict = doc.AsDict();
   auto& type = dict.at("type").AsString(); 
@@ -41,6 +63,14 @@ RequestPtr MakeRequest(const Json::Node& doc) {
     return make_shared<FindRequest>(dict);
   } else if (type == "RouteToCompany") {
     return make_shared<RouteToCompanyRequest>(dict);
+  } else if (type == "Reachable") {
+    return make_shared<ReachableRequest>(dict);
+  } else if (type == "RouteMatrix") {
+    return make_shared<RouteMatrixRequest>(dict);
+  } else if (type == "NearestStops") {
+    return make_shared<NearestStopsRequest>(dict);
+  } else if (type == "SuggestCompanies") {
+    return make_shared<SuggestRequest>(dict);
   }
   throw invalid_argument("");
 }
\ No newline at end of file
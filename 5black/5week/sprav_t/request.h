@@ -17,10 +17,17 @@ enum class RequestType {
   STAT_BUS,
   STAT_STOP,
   ROUTE,
+  ROUTE_TO_COMPANY,
   MAP,
-  FIND_COMPANIES
+  FIND_COMPANIES,
+  REACHABLE,
+  ROUTE_MATRIX,
+  NEAREST_STOPS,
+  SUGGEST_COMPANIES
 };
 
+std::string_view ToString(RequestType type);
+
 class Response {
  public:
   Response(RequestType type)
@@ -29,6 +36,10 @@ class Response {
 
   virtual Json::Node AsJson() const = 0;
 
+  RequestType GetType() const {
+    return type_;
+  }
+
   bool empty() const {
     return empty_;
   }
@@ -59,8 +70,17 @@ class Request {
   virtual ResponsePtr Process(SpravPtr sprav) const = 0;
   virtual Json::Node AsJson() const = 0;
 
+  RequestType GetType() const {
+    return type_;
+  }
+
+  size_t GetId() const {
+    return id_;
+  }
+
  protected:
   RequestType type_;
+  size_t id_ = 0;
 };
 using RequestPtr = std::shared_ptr<Request>;
 
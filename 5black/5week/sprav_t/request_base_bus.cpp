@@ -1,8 +1,16 @@
 #include "request_base_bus.h"
 
+using namespace std;
+
 BaseBusRequest::BaseBusRequest(const Json::Dict& dict)
     : Request(RequestType::BASE_BUS) {
   name_ = dict.at("name").AsString();
+  if (auto it = dict.find("removed"); it != dict.end()) {
+    is_removed_ = it->second.AsBool();
+  }
+  if (is_removed_) {
+    return;
+  }
   auto rt_it = dict.find("is_roundtrip");
   is_ring_route_ = rt_it != dict.end() ? rt_it->second.AsBool() : false;
   for (auto& stop : dict.at("stops").AsArray()) {
@@ -11,6 +19,10 @@ BaseBusRequest::BaseBusRequest(const Json::Dict& dict)
 }
 
 ResponsePtr BaseBusRequest::Process(SpravPtr sprav) const {
+  if (is_removed_) {
+    sprav->RemoveBus(name_);
+    return make_shared<EmptyResponse>(type_);
+  }
   sprav->AddBus(name_, stops_, is_ring_route_);
   return make_shared<EmptyResponse>(type_);
 }
@@ -19,6 +31,10 @@ Json::Node BaseBusRequest::AsJson() const {
   Json::Dict dict;
   dict["type"] = "Bus";
   dict["name"] = name_;
+  if (is_removed_) {
+    dict["removed"] = true;
+    return dict;
+  }
   dict["is_roundtrip"] = is_ring_route_;
   Json::Array stops;
   for (const auto& stop : stops_) {
@@ -10,7 +10,8 @@ class BaseBusRequest : public Request {
   Json::Node AsJson() const override;
 
  private:
-  string name_;
-  list<string> stops_;
+  std::string name_;
+  std::list<std::string> stops_;
   bool is_ring_route_;
+  bool is_removed_ = false;
 };
\ No newline at end of file
@@ -1,8 +1,16 @@
 #include "request_base_stop.h"
 
+using namespace std;
+
 BaseStopRequest::BaseStopRequest(const Json::Dict& dict)
     : Request(RequestType::BASE_STOP) {
   name_ = dict.at("name").AsString();
+  if (auto it = dict.find("removed"); it != dict.end()) {
+    is_removed_ = it->second.AsBool();
+  }
+  if (is_removed_) {
+    return;
+  }
   lat_ = dict.at("latitude").AsDouble();
   lon_ = dict.at("longitude").AsDouble();
   for (auto& [name, dist] : dict.at("road_distances").AsDict()) {
@@ -11,6 +19,10 @@ BaseStopRequest::BaseStopRequest(const Json::Dict& dict)
 }
 
 ResponsePtr BaseStopRequest::Process(SpravPtr sprav) const {
+  if (is_removed_) {
+    sprav->RemoveStop(name_);
+    return make_shared<EmptyResponse>(type_);
+  }
   sprav->AddStop(name_, lat_, lon_, distances_);
   return make_shared<EmptyResponse>(type_);
 }
@@ -19,6 +31,10 @@ Json::Node BaseStopRequest::AsJson() const {
   Json::Dict dict;
   dict["type"] = "Stop";
   dict["name"] = name_;
+  if (is_removed_) {
+    dict["removed"] = true;
+    return dict;
+  }
   dict["latitude"] = lat_;
   dict["longitude"] = lon_;
   Json::Dict distances;
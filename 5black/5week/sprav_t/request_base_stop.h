@@ -10,8 +10,9 @@ class BaseStopRequest : public Request {
   Json::Node AsJson() const override;
 
  private:
-  string name_;
+  std::string name_;
   double lat_;
   double lon_;
-  unordered_map<string, int> distances_;
+  std::unordered_map<std::string, int> distances_;
+  bool is_removed_ = false;
 };
\ No newline at end of file
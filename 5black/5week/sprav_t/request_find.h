@@ -25,6 +25,5 @@ class FindRequest : public Request {
   Json::Node AsJson() const override;
 
  private:
-  size_t id_ = 0;
   YellowPages::Query query_;
 };
\ No newline at end of file
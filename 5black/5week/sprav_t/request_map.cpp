@@ -2,7 +2,7 @@
 
 using namespace std;
 
-MapResponse::MapResponse(RequestType type, size_t id, string map)
+MapResponse::MapResponse(RequestType type, size_t id, Json::Raw map)
     : Response(type), id_(id), map_(move(map)) {
   empty_ = false;
 }
@@ -20,7 +20,7 @@ MapRequest::MapRequest(const Json::Dict& dict)
 }
 
 ResponsePtr MapRequest::Process(SpravPtr sprav) const {
-  return make_shared<MapResponse>(type_, id_, sprav->GetMap());
+  return make_shared<MapResponse>(type_, id_, sprav->GetMapJson());
 }
 
 Json::Node MapRequest::AsJson() const {
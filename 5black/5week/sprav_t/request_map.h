@@ -4,13 +4,13 @@
 
 class MapResponse : public Response {
  public:
-  MapResponse(RequestType type, size_t id, std::string map);
+  MapResponse(RequestType type, size_t id, Json::Raw map);
 
   Json::Node AsJson() const override;
 
  private:
   size_t id_ = 0;
-  std::string map_;
+  Json::Raw map_;
 };
 
 class MapRequest : public Request {
@@ -21,5 +21,4 @@ class MapRequest : public Request {
   Json::Node AsJson() const override;
 
  private:
-  size_t id_ = 0;
 };
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "request_nearest_stops.h"
+
+using namespace std;
+
+namespace {
+
+GeoIndex::Point ParsePoint(const Json::Dict& dict) {
+  return {dict.at("latitude").AsDouble(), dict.at("longitude").AsDouble()};
+}
+
+Json::Dict PointAsJson(GeoIndex::Point point) {
+  return {
+    {"latitude", point.lat},
+    {"longitude", point.lon}
+  };
+}
+
+} // namespace
+
+NearestStopsResponse::NearestStopsResponse(RequestType type, size_t id, SpravPtr sprav, vector<GeoIndex::Found> results, bool is_batch)
+    : Response(type)
+    , id_(id)
+    , sprav_(move(sprav))
+    , results_(move(results))
+    , is_batch_(is_batch)
+{
+  empty_ = false;
+}
+
+Json::Node NearestStopsResponse::AsJson() const {
+  Json::Dict dict;
+  dict["request_id"] = id_;
+  if (!is_batch_) {
+    dict["stops"] = StopsAsJson(results_.front());
+    return dict;
+  }
+
+  Json::Array results;
+  results.reserve(results_.size());
+  for (const auto& found : results_) {
+    results.push_back(Json::Dict{{"stops", StopsAsJson(found)}});
+  }
+  dict["results"] = move(results);
+  return dict;
+}
+
+Json::Array NearestStopsResponse::StopsAsJson(const GeoIndex::Found& found) const {
+  Json::Array stops;
+  stops.reserve(found.size());
+  for (auto [stop_id, distance] : found) {
+    stops.push_back(Json::Dict{
+      {"name", string(sprav_->GetStop(stop_id).name)},
+      {"distance", distance}
+    });
+  }
+  return stops;
+}
+
+NearestStopsRequest::NearestStopsRequest(const Json::Dict& dict)
+    : Request(RequestType::NEAREST_STOPS) {
+  id_ = dict.at("id").AsInt();
+  if (auto it = dict.find("points"); it != dict.end()) {
+    is_batch_ = true;
+    for (const auto& point : it->second.AsArray()) {
+      points_.push_back(ParsePoint(point.AsDict()));
+    }
+  } else {
+    points_.push_back(ParsePoint(dict));
+  }
+  if (auto it = dict.find("count"); it != dict.end()) {
+    count_ = it->second.AsInt();
+  }
+  if (auto it = dict.find("radius"); it != dict.end()) {
+    radius_ = it->second.AsDouble();
+  }
+}
+
+ResponsePtr NearestStopsRequest::Process(SpravPtr sprav) const {
+  vector<GeoIndex::Found> results;
+  results.reserve(points_.size());
+  for (auto point : points_) {
+    results.push_back(sprav->FindNearestStops(point, count_, radius_));
+  }
+  return make_shared<NearestStopsResponse>(type_, id_, sprav, move(results), is_batch_);
+}
+
+Json::Node NearestStopsRequest::AsJson() const {
+  Json::Dict dict;
+  dict["id"] = id_;
+  if (is_batch_) {
+    Json::Array points;
+    for (auto point : points_) {
+      points.push_back(PointAsJson(point));
+    }
+    dict["points"] = move(points);
+  } else {
+    dict["latitude"] = points_.front().lat;
+    dict["longitude"] = points_.front().lon;
+  }
+  dict["count"] = count_;
+  if (radius_) {
+    dict["radius"] = *radius_;
+  }
+  return dict;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "request.h"
+
+class NearestStopsResponse : public Response {
+ public:
+  NearestStopsResponse(RequestType type, size_t id, SpravPtr sprav, std::vector<GeoIndex::Found> results, bool is_batch);
+
+  Json::Node AsJson() const override;
+
+ private:
+  size_t id_ = 0;
+  SpravPtr sprav_;
+  std::vector<GeoIndex::Found> results_;
+  bool is_batch_ = false;
+
+  Json::Array StopsAsJson(const GeoIndex::Found& found) const;
+};
+
+class NearestStopsRequest : public Request {
+ public:
+  NearestStopsRequest(const Json::Dict& dict);
+
+  ResponsePtr Process(SpravPtr sprav) const override;
+  Json::Node AsJson() const override;
+
+ private:
+  // A single point comes as latitude and longitude, a batch as points
+  std::vector<GeoIndex::Point> points_;
+  bool is_batch_ = false;
+  size_t count_ = 1;
+  std::optional<double> radius_;
+};
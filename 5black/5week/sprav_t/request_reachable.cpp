@@ -0,0 +1,92 @@
+#include "request_reachable.h"
+
+#include <google/protobuf/util/json_util.h>
+
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+using ::google::protobuf::util::JsonStringToMessage;
+using ::google::protobuf::util::JsonParseOptions;
+using ::google::protobuf::util::Status;
+
+namespace {
+
+const JsonParseOptions JSON_PARSE_OPTIONS = [](){
+  JsonParseOptions o;
+  o.ignore_unknown_fields = true;
+  return o;
+}();
+
+} // namespace
+
+ReachableResponse::ReachableResponse(RequestType type, size_t id, SpravPtr sprav, optional<Sprav::Reachable> result)
+    : Response(type)
+    , id_(id)
+    , sprav_(sprav)
+    , result_(std::move(result))
+{
+  empty_ = false;
+}
+
+Json::Node ReachableResponse::AsJson() const {
+  Json::Dict dict;
+  dict["request_id"] = id_;
+  if (!result_) {
+    dict["error_message"] = "not found";
+    return dict;
+  }
+
+  Json::Array stops;
+  stops.reserve(result_->stops.size());
+  for (auto [stop_id, time] : result_->stops) {
+    stops.push_back(Json::Dict{
+      {"name", string(sprav_->GetStop(stop_id).name)},
+      {"time", time}
+    });
+  }
+
+  Json::Array companies;
+  companies.reserve(result_->companies.size());
+  for (auto [company_id, time] : result_->companies) {
+    companies.push_back(Json::Dict{
+      {"name", sprav_->GetPages()->GetCompanyMainName(company_id)},
+      {"time", time}
+    });
+  }
+
+  dict["stops"] = std::move(stops);
+  dict["companies"] = std::move(companies);
+  return dict;
+}
+
+ReachableRequest::ReachableRequest(const Json::Dict& dict)
+    : Request(RequestType::REACHABLE) {
+  id_ = dict.at("id").AsInt();
+  from_ = dict.at("from").AsString();
+  max_time_ = dict.at("max_time").AsDouble();
+
+  if (auto it = dict.find("companies"); it != dict.end()) {
+    ostringstream ss;
+    Json::PrintNode(it->second.AsDict(), ss);
+    query_.emplace();
+    if (auto status = JsonStringToMessage(ss.str(), &query_.value(), JSON_PARSE_OPTIONS); status != Status::OK) {
+      ostringstream err_ss;
+      err_ss << "Failed to parse " << quoted(ss.str()) << " as find companies request: " << status.ToString();
+      throw runtime_error(err_ss.str());
+    }
+  }
+}
+
+ResponsePtr ReachableRequest::Process(SpravPtr sprav) const {
+  return make_shared<ReachableResponse>(type_, id_, sprav, sprav->FindReachable(from_, max_time_, query_));
+}
+
+Json::Node ReachableRequest::AsJson() const {
+  Json::Dict dict;
+  dict["id"] = id_;
+  dict["from"] = from_;
+  dict["max_time"] = max_time_;
+  return dict;
+}
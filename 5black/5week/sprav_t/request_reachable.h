@@ -0,0 +1,31 @@
+#pragma once
+
+#include <optional>
+
+#include "database_queries.pb.h"
+#include "request.h"
+
+class ReachableResponse : public Response {
+ public:
+  ReachableResponse(RequestType type, size_t id, SpravPtr sprav, std::optional<Sprav::Reachable> result);
+
+  Json::Node AsJson() const override;
+
+ private:
+  size_t id_ = 0;
+  SpravPtr sprav_;
+  std::optional<Sprav::Reachable> result_;
+};
+
+class ReachableRequest : public Request {
+ public:
+  ReachableRequest(const Json::Dict& dict);
+
+  ResponsePtr Process(SpravPtr sprav) const override;
+  Json::Node AsJson() const override;
+
+ private:
+  std::string from_;
+  double max_time_ = 0;
+  std::optional<YellowPages::Query> query_;
+};
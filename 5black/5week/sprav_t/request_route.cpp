@@ -1,10 +1,19 @@
 #include "request_route.h"
 
-RouteResponse::RouteResponse(RequestType type, size_t id, Sprav::Route route, std::string map)
-    : Response(type), id_(id), route_(move(route)), map_(map) {
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+RouteResponse::RouteResponse(RequestType type, size_t id, Sprav::Route route, Json::Raw map)
+    : Response(type), id_(id), route_(move(route)), map_(move(map)) {
   empty_ = false;
 }
 
+void RouteResponse::SetAlternatives(Alternatives alternatives) {
+  alternatives_ = move(alternatives);
+}
+
 Json::Node RouteResponse::AsJson() const {
   Json::Dict dict;
   dict["request_id"] = id_;
@@ -12,6 +21,17 @@ Json::Node RouteResponse::AsJson() const {
     dict["map"] = map_;
     dict["total_time"] = route_.GetTotalTime();
     dict["items"] = route_.AsJson();
+    if (alternatives_) {
+      Json::Array alternatives;
+      for (const auto& [route, map] : *alternatives_) {
+        Json::Dict alternative;
+        alternative["map"] = map;
+        alternative["total_time"] = route.GetTotalTime();
+        alternative["items"] = route.AsJson();
+        alternatives.push_back(move(alternative));
+      }
+      dict["alternatives"] = move(alternatives);
+    }
   } else {
     dict["error_message"] = "not found";
   }
@@ -23,12 +43,28 @@ RouteRequest::RouteRequest(const Json::Dict& dict)
   id_ = dict.at("id").AsInt();
   from_ = dict.at("from").AsString();
   to_ = dict.at("to").AsString();
+  if (auto it = dict.find("max_alternatives"); it != dict.end()) {
+    const int max_alternatives = it->second.AsInt();
+    if (max_alternatives < 0) {
+      throw invalid_argument("Failed to parse route request: negative max_alternatives " + to_string(max_alternatives));
+    }
+    max_alternatives_ = min<size_t>(max_alternatives, Sprav::MAX_ROUTE_ALTERNATIVES);
+  }
 }
 
 ResponsePtr RouteRequest::Process(SpravPtr sprav) const {
   auto route = sprav->FindRoute(from_, to_);
-  auto map = sprav->GetRouteMap(route);
-  return make_shared<RouteResponse>(type_, id_, std::move(route), std::move(map));
+  auto map = sprav->GetRouteMapJson(route);
+  auto response = make_shared<RouteResponse>(type_, id_, std::move(route), std::move(map));
+  if (max_alternatives_ > 0) {
+    RouteResponse::Alternatives alternatives;
+    for (auto& alternative : sprav->FindRouteAlternatives(from_, to_, max_alternatives_)) {
+      auto alternative_map = sprav->GetRouteMapJson(alternative);
+      alternatives.emplace_back(std::move(alternative), std::move(alternative_map));
+    }
+    response->SetAlternatives(std::move(alternatives));
+  }
+  return response;
 }
 
 Json::Node RouteRequest::AsJson() const {
@@ -36,5 +72,8 @@ Json::Node RouteRequest::AsJson() const {
   dict["id"] = id_;
   dict["from"] = from_;
   dict["to"] = to_;
+  if (max_alternatives_ > 0) {
+    dict["max_alternatives"] = max_alternatives_;
+  }
   return dict;
 }
\ No newline at end of file
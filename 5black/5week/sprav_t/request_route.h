@@ -4,14 +4,18 @@
 
 class RouteResponse : public Response {
  public:
-  RouteResponse(RequestType type, size_t id, Sprav::Route route, std::string map);
+  RouteResponse(RequestType type, size_t id, Sprav::Route route, Json::Raw map);
+
+  using Alternatives = std::vector<std::pair<Sprav::Route, Json::Raw>>;
+  void SetAlternatives(Alternatives alternatives);
 
   Json::Node AsJson() const override;
 
  private:
   size_t id_ = 0;
   Sprav::Route route_;
-  std::string map_;
+  Json::Raw map_;
+  std::optional<Alternatives> alternatives_;
 };
 
 class RouteRequest : public Request {
@@ -22,7 +26,7 @@ class RouteRequest : public Request {
   Json::Node AsJson() const override;
 
  private:
-  size_t id_ = 0;
-  string from_;
-  string to_;
+  std::string from_;
+  std::string to_;
+  size_t max_alternatives_ = 0;
 };
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "request_route_matrix.h"
+
+using namespace std;
+
+namespace {
+
+vector<string> ParseNames(const Json::Node& node) {
+  vector<string> names;
+  names.reserve(node.AsArray().size());
+  for (const auto& name : node.AsArray()) {
+    names.push_back(name.AsString());
+  }
+  return names;
+}
+
+Json::Array NamesAsJson(const vector<string>& names) {
+  return Json::Array(names.begin(), names.end());
+}
+
+} // namespace
+
+RouteMatrixResponse::RouteMatrixResponse(RequestType type, size_t id, Sprav::RouteMatrix matrix)
+    : Response(type), id_(id), matrix_(std::move(matrix)) {
+  empty_ = false;
+}
+
+Json::Node RouteMatrixResponse::AsJson() const {
+  // Unreachable pairs are reported as -1 to keep rows plain numbers
+  Json::Array times;
+  times.reserve(matrix_.sources_count);
+  for (size_t i = 0; i < matrix_.sources_count; ++i) {
+    Json::Array row;
+    row.reserve(matrix_.targets_count);
+    for (size_t j = 0; j < matrix_.targets_count; ++j) {
+      row.push_back(matrix_.times[i * matrix_.targets_count + j].value_or(-1.0));
+    }
+    times.push_back(std::move(row));
+  }
+
+  Json::Dict dict;
+  dict["request_id"] = id_;
+  dict["times"] = std::move(times);
+
+  if (!matrix_.routes.empty()) {
+    Json::Array routes;
+    routes.reserve(matrix_.sources_count);
+    for (size_t i = 0; i < matrix_.sources_count; ++i) {
+      Json::Array row;
+      row.reserve(matrix_.targets_count);
+      for (size_t j = 0; j < matrix_.targets_count; ++j) {
+        const auto& route = matrix_.routes[i * matrix_.targets_count + j];
+        if (route) {
+          row.push_back(Json::Dict{
+            {"total_time", route.GetTotalTime()},
+            {"items", route.AsJson()}
+          });
+        } else {
+          row.push_back(Json::Dict{{"error_message", "not found"}});
+        }
+      }
+      routes.push_back(std::move(row));
+    }
+    dict["routes"] = std::move(routes);
+  }
+  return dict;
+}
+
+RouteMatrixRequest::RouteMatrixRequest(const Json::Dict& dict)
+    : Request(RequestType::ROUTE_MATRIX) {
+  id_ = dict.at("id").AsInt();
+  from_ = ParseNames(dict.at("from"));
+  to_ = ParseNames(dict.at("to"));
+  if (auto it = dict.find("with_routes"); it != dict.end()) {
+    with_routes_ = it->second.AsBool();
+  }
+}
+
+ResponsePtr RouteMatrixRequest::Process(SpravPtr sprav) const {
+  return make_shared<RouteMatrixResponse>(type_, id_, sprav->FindRouteMatrix(from_, to_, with_routes_));
+}
+
+Json::Node RouteMatrixRequest::AsJson() const {
+  Json::Dict dict;
+  dict["id"] = id_;
+  dict["from"] = NamesAsJson(from_);
+  dict["to"] = NamesAsJson(to_);
+  dict["with_routes"] = with_routes_;
+  return dict;
+}
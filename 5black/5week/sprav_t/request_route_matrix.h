@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "request.h"
+
+class RouteMatrixResponse : public Response {
+ public:
+  RouteMatrixResponse(RequestType type, size_t id, Sprav::RouteMatrix matrix);
+
+  Json::Node AsJson() const override;
+
+ private:
+  size_t id_ = 0;
+  Sprav::RouteMatrix matrix_;
+};
+
+class RouteMatrixRequest : public Request {
+ public:
+  RouteMatrixRequest(const Json::Dict& dict);
+
+  ResponsePtr Process(SpravPtr sprav) const override;
+  Json::Node AsJson() const override;
+
+ private:
+  std::vector<std::string> from_;
+  std::vector<std::string> to_;
+  bool with_routes_ = false;
+};
@@ -21,8 +21,8 @@ const JsonParseOptions JSON_PARSE_OPTIONS = [](){
 
 } // namespace
 
-RouteToCompanyResponse::RouteToCompanyResponse(RequestType type, size_t id, Sprav::Route route, std::string map)
-    : Response(type), id_(id), route_(move(route)), map_(map) {
+RouteToCompanyResponse::RouteToCompanyResponse(RequestType type, size_t id, Sprav::Route route, Json::Raw map)
+    : Response(type), id_(id), route_(move(route)), map_(move(map)) {
   empty_ = false;
 }
 
@@ -40,7 +40,7 @@ Json::Node RouteToCompanyResponse::AsJson() const {
 }
 
 RouteToCompanyRequest::RouteToCompanyRequest(const Json::Dict& dict)
-    : Request(RequestType::ROUTE) {
+    : Request(RequestType::ROUTE_TO_COMPANY) {
   id_ = dict.at("id").AsInt();
   from_ = dict.at("from").AsString();
 
@@ -57,7 +57,7 @@ RouteToCompanyRequest::RouteToCompanyRequest(const Json::Dict& dict)
 
 ResponsePtr RouteToCompanyRequest::Process(SpravPtr sprav) const {
   auto route = sprav->FindRouteToCompany(from_, query_, time_);
-  auto map = sprav->GetRouteMap(route);
+  auto map = sprav->GetRouteMapJson(route);
   return make_shared<RouteToCompanyResponse>(type_, id_, std::move(route), std::move(map));
 }
 
@@ -6,14 +6,14 @@
 
 class RouteToCompanyResponse : public Response {
  public:
-  RouteToCompanyResponse(RequestType type, size_t id, Sprav::Route route, std::string map);
+  RouteToCompanyResponse(RequestType type, size_t id, Sprav::Route route, Json::Raw map);
 
   Json::Node AsJson() const override;
 
  private:
   size_t id_ = 0;
   Sprav::Route route_;
-  std::string map_;
+  Json::Raw map_;
 };
 
 class RouteToCompanyRequest : public Request {
@@ -24,8 +24,7 @@ class RouteToCompanyRequest : public Request {
   Json::Node AsJson() const override;
 
  private:
-  size_t id_ = 0;
-  string from_;
+  std::string from_;
   YellowPages::Query query_;
   Time time_;
 };
\ No newline at end of file
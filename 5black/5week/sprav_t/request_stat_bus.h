@@ -4,13 +4,12 @@
 
 class StatBusResponse : public Response {
  public:
-  StatBusResponse(RequestType type, string name, size_t id, const Bus* bus);
-  void SetId(size_t id);
+  StatBusResponse(RequestType type, std::string name, size_t id, const Bus* bus);
 
   Json::Node AsJson() const override;
 
  private:
-  string name_;
+  std::string name_;
   size_t id_ = 0;
   const Bus* bus_ = nullptr;
 };
@@ -24,8 +23,5 @@ class StatBusRequest : public Request {
   Json::Node AsJson() const override;
 
  private:
-  string name_;
-  size_t id_ = 0;
-
-  static unordered_map<std::string, StatBusResponsePtr> response_cache_;
+  std::string name_;
 };
\ No newline at end of file
@@ -4,13 +4,12 @@
 
 class StatStopResponse : public Response {
  public:
-  StatStopResponse(RequestType type, string name, size_t id, SpravPtr sprav, const Stop* stop);
-  void SetId(size_t id);
+  StatStopResponse(RequestType type, std::string name, size_t id, SpravPtr sprav, const Stop* stop);
 
   Json::Node AsJson() const override;
 
  private:
-  string name_;
+  std::string name_;
   size_t id_ = 0;
   SpravPtr sprav_;
   const Stop* stop_ = nullptr;
@@ -25,8 +24,5 @@ class StatStopRequest : public Request {
   Json::Node AsJson() const override;
 
  private:
-  string name_;
-  size_t id_ = 0;
-
-  static unordered_map<std::string, StatStopResponsePtr> response_cache_;
+  std::string name_;
 };
\ No newline at end of file
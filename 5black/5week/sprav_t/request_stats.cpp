@@ -0,0 +1,109 @@
+#include "request_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+using namespace std;
+
+namespace {
+
+bool SlowerThan(const RequestStats::Request& lhs, const RequestStats::Request& rhs) {
+  return lhs.GetTotal() > rhs.GetTotal();
+}
+
+} // namespace
+
+size_t LatencyHistogram::GetBucket(uint64_t ns) {
+  if (ns < SUB_COUNT) {
+    return ns;
+  }
+  const size_t exp = 63 - __builtin_clzll(ns);
+  const size_t sub = (ns >> (exp - SUB_BITS)) & (SUB_COUNT - 1);
+  return (exp - SUB_BITS + 1) * SUB_COUNT + sub;
+}
+
+uint64_t LatencyHistogram::GetBucketLowerBound(size_t bucket) {
+  if (bucket < SUB_COUNT) {
+    return bucket;
+  }
+  const size_t exp = bucket / SUB_COUNT + SUB_BITS - 1;
+  const size_t sub = bucket % SUB_COUNT;
+  return static_cast<uint64_t>(SUB_COUNT + sub) << (exp - SUB_BITS);
+}
+
+void LatencyHistogram::Add(uint64_t ns) {
+  ++buckets_[GetBucket(ns)];
+  ++count_;
+  max_ = max(max_, ns);
+}
+
+uint64_t LatencyHistogram::GetPercentile(double q) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  const size_t rank = max<size_t>(1, ceil(q * count_));
+  size_t seen = 0;
+  for (size_t bucket = 0; bucket < BUCKETS_COUNT; ++bucket) {
+    seen += buckets_[bucket];
+    if (seen >= rank) {
+      if (bucket + 1 == BUCKETS_COUNT) {
+        return max_;
+      }
+      return min(max_, GetBucketLowerBound(bucket + 1) - 1);
+    }
+  }
+  return max_;
+}
+
+void RequestStats::Add(RequestType type, size_t id, uint64_t process_ns, uint64_t json_ns) {
+  auto& histograms = by_type_[type];
+  histograms.process.Add(process_ns);
+  histograms.json.Add(json_ns);
+
+  if (slowest_count_ == 0) {
+    return;
+  }
+  Request request{type, id, process_ns, json_ns};
+  if (slowest_.size() < slowest_count_) {
+    slowest_.push_back(request);
+    push_heap(slowest_.begin(), slowest_.end(), SlowerThan);
+  } else if (SlowerThan(request, slowest_.front())) {
+    pop_heap(slowest_.begin(), slowest_.end(), SlowerThan);
+    slowest_.back() = request;
+    push_heap(slowest_.begin(), slowest_.end(), SlowerThan);
+  }
+}
+
+vector<RequestStats::Request> RequestStats::GetSlowest() const {
+  auto result = slowest_;
+  sort(result.begin(), result.end(), SlowerThan);
+  return result;
+}
+
+void RequestStats::Print(ostream& os) const {
+  const auto flags = os.flags();
+  const auto precision = os.precision();
+
+  os << "type,phase,count,p50_ms,p90_ms,p99_ms,max_ms\n" << fixed << setprecision(3);
+  for (const auto& [type, histograms] : by_type_) {
+    for (const auto& [phase, histogram] : {pair{"process", &histograms.process}, pair{"json", &histograms.json}}) {
+      os << ToString(type) << "," << phase
+         << "," << histogram->GetCount()
+         << "," << histogram->GetPercentile(0.5) / 1e6
+         << "," << histogram->GetPercentile(0.9) / 1e6
+         << "," << histogram->GetPercentile(0.99) / 1e6
+         << "," << histogram->GetMax() / 1e6 << "\n";
+    }
+  }
+
+  os << "slowest_id,type,process_ms,json_ms\n";
+  for (const auto& request : GetSlowest()) {
+    os << request.id << "," << ToString(request.type)
+       << "," << request.process_ns / 1e6
+       << "," << request.json_ns / 1e6 << "\n";
+  }
+
+  os.flags(flags);
+  os.precision(precision);
+}
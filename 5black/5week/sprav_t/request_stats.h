@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <vector>
+
+#include "request.h"
+
+// Latency histogram with log2 buckets, each split into 4 linear
+// sub-buckets: percentiles are off by at most a quarter of their octave.
+class LatencyHistogram {
+ public:
+  void Add(uint64_t ns);
+
+  size_t GetCount() const {
+    return count_;
+  }
+
+  uint64_t GetMax() const {
+    return max_;
+  }
+
+  // Upper bound of the bucket holding the q-th quantile, q in [0, 1]
+  uint64_t GetPercentile(double q) const;
+
+ private:
+  static const size_t SUB_BITS = 2;
+  static const size_t SUB_COUNT = 1 << SUB_BITS;
+  static const size_t BUCKETS_COUNT = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+  std::array<size_t, BUCKETS_COUNT> buckets_ = {};
+  size_t count_ = 0;
+  uint64_t max_ = 0;
+
+  static size_t GetBucket(uint64_t ns);
+  static uint64_t GetBucketLowerBound(size_t bucket);
+};
+
+// Process and AsJson latencies of stat requests by type, plus the
+// slowest requests by their total time
+class RequestStats {
+ public:
+  explicit RequestStats(size_t slowest_count = 10)
+    : slowest_count_(slowest_count)
+  {}
+
+  void Add(RequestType type, size_t id, uint64_t process_ns, uint64_t json_ns);
+
+  const LatencyHistogram& GetProcess(RequestType type) const {
+    return by_type_.at(type).process;
+  }
+
+  const LatencyHistogram& GetJson(RequestType type) const {
+    return by_type_.at(type).json;
+  }
+
+  struct Request {
+    RequestType type;
+    size_t id;
+    uint64_t process_ns;
+    uint64_t json_ns;
+
+    uint64_t GetTotal() const {
+      return process_ns + json_ns;
+    }
+  };
+
+  // Slowest first
+  std::vector<Request> GetSlowest() const;
+
+  void Print(std::ostream& os) const;
+
+ private:
+  struct Histograms {
+    LatencyHistogram process;
+    LatencyHistogram json;
+  };
+
+  const size_t slowest_count_;
+  std::map<RequestType, Histograms> by_type_;
+  std::vector<Request> slowest_;  // min-heap by total time
+};
@@ -0,0 +1,57 @@
+#include "request_suggest.h"
+
+using namespace std;
+
+SuggestResponse::SuggestResponse(RequestType type, size_t id, SpravPtr sprav, SuggestIndex::Found found)
+    : Response(type)
+    , id_(id)
+    , sprav_(move(sprav))
+    , found_(move(found))
+{
+  empty_ = false;
+}
+
+Json::Node SuggestResponse::AsJson() const {
+  Json::Array companies;
+  companies.reserve(found_.size());
+  for (auto [company_id, distance] : found_) {
+    companies.push_back(Json::Dict{
+      {"id", company_id},
+      {"name", sprav_->GetPages()->GetCompanyMainName(company_id)},
+      {"distance", distance}
+    });
+  }
+
+  return Json::Dict{
+    {"request_id", id_},
+    {"companies", move(companies)}
+  };
+}
+
+SuggestRequest::SuggestRequest(const Json::Dict& dict)
+    : Request(RequestType::SUGGEST_COMPANIES)
+    , query_(dict.at("query").AsString()) {
+  id_ = dict.at("id").AsInt();
+  if (auto it = dict.find("count"); it != dict.end()) {
+    count_ = it->second.AsInt();
+  }
+  if (auto it = dict.find("max_distance"); it != dict.end()) {
+    max_distance_ = it->second.AsInt();
+  }
+}
+
+ResponsePtr SuggestRequest::Process(SpravPtr sprav) const {
+  const size_t max_distance = max_distance_.value_or(SuggestIndex::GetDefaultDistance(query_));
+  return make_shared<SuggestResponse>(type_, id_, sprav, sprav->SuggestCompanies(query_, count_, max_distance));
+}
+
+Json::Node SuggestRequest::AsJson() const {
+  Json::Dict dict;
+  dict["id"] = id_;
+  dict["query"] = query_;
+  dict["count"] = count_;
+  if (max_distance_) {
+    dict["max_distance"] = *max_distance_;
+  }
+  return dict;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "request.h"
+
+class SuggestResponse : public Response {
+ public:
+  SuggestResponse(RequestType type, size_t id, SpravPtr sprav, SuggestIndex::Found found);
+
+  Json::Node AsJson() const override;
+
+ private:
+  size_t id_ = 0;
+  SpravPtr sprav_;
+  SuggestIndex::Found found_;
+};
+
+class SuggestRequest : public Request {
+ public:
+  SuggestRequest(const Json::Dict& dict);
+
+  ResponsePtr Process(SpravPtr sprav) const override;
+  Json::Node AsJson() const override;
+
+ private:
+  std::string query_;
+  size_t count_ = 5;
+  // Chosen by the query length if not given
+  std::optional<size_t> max_distance_;
+};
@@ -1,14 +1,19 @@
 #pragma once
 
 #include "graph.h"
-#include "profile.h"
+#include "trace.h"
 #include "transport_catalog.pb.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <future>
 #include <iterator>
 #include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -32,65 +37,107 @@ namespace Graph {
     };
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    std::optional<Weight> GetRouteWeight(VertexId from, VertexId to) const;
     EdgeId GetRouteEdgeId(RouteId route_id, size_t edge_idx) const;
     const Edge& GetRouteEdge(RouteId route_id, size_t edge_idx) const;
     void ReleaseRoute(RouteId route_id);
 
+    // Registers a route found outside the table, e.g. by a separate
+    // search, so that it is expanded and released like built ones
+    RouteInfo AddRoute(Weight weight, std::vector<EdgeId> edges) const;
+
+    void AddEdge(EdgeId edge_id);
+
+    size_t GetMemoryUsage() const;
+
     void Serialize(SpravSerialize::Router& m);
 
   private:
     const Graph& graph_;
 
-    struct RouteInternalData {
-      Weight weight;
-      std::optional<EdgeId> prev_edge;
-    };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
-    RoutesInternalData routes_internal_data_;
+    // Routes between all pairs of vertices, row by source vertex: the
+    // weight and the last edge of every route. Only the route from a
+    // vertex to itself has no last edge, so NO_EDGE elsewhere means that
+    // there is no route.
+    static constexpr EdgeId NO_EDGE = static_cast<EdgeId>(-1);
+    size_t vertex_count_ = 0;
+    std::vector<Weight> route_weights_;
+    std::vector<EdgeId> route_prev_edges_;
 
     using ExpandedRoute = std::vector<EdgeId>;
     mutable RouteId next_route_id_ = 0;
     mutable std::unordered_map<RouteId, ExpandedRoute> expanded_routes_cache_;
 
+    size_t GetRouteIdx(VertexId from, VertexId to) const {
+      return from * vertex_count_ + to;
+    }
+
+    bool HasRoute(VertexId from, VertexId to) const {
+      return from == to || route_prev_edges_[GetRouteIdx(from, to)] != NO_EDGE;
+    }
+
+    // Edges entering every vertex by edge id, and where the rank of the
+    // last edge of a route to every vertex lies in a serialized row
+    struct RowLayout {
+      std::vector<size_t> incoming_begin;
+      std::vector<EdgeId> incoming;
+      std::vector<size_t> edge_rank;
+      std::vector<VertexId> edge_from;
+      std::vector<Weight> edge_weight;
+      std::vector<size_t> rank_offset;
+      std::vector<uint8_t> rank_width;
+    };
+    RowLayout BuildRowLayout() const;
+
+    // Arrays reused by the rows decoded on one thread
+    struct RowScratch {
+      std::vector<uint8_t> padded;
+      std::vector<uint8_t> resolved;
+      std::vector<VertexId> chain;
+    };
+
     void ParseFrom(const SpravSerialize::Router& m);
+    std::string SerializeRow(const RowLayout& layout, VertexId from) const;
+    void ParseRow(const RowLayout& layout, VertexId from, const std::string& bytes, RowScratch& scratch);
 
     void InitializeRoutesInternalData(const Graph& graph) {
-      LOG_DURATION("Router: init internal");
-      const size_t vertex_count = graph.GetVertexCount();
-      for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-        routes_internal_data_[vertex][vertex] = RouteInternalData{0, std::nullopt};
+      TRACE("Router: init internal");
+      for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
         for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
           const auto& edge = graph.GetEdge(edge_id);
           assert(edge.weight >= 0);
-          auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-          if (!route_internal_data || route_internal_data->weight > edge.weight) {
-            route_internal_data = RouteInternalData{edge.weight, edge_id};
+          if (edge.to == vertex) {
+            continue;
+          }
+          const size_t idx = GetRouteIdx(vertex, edge.to);
+          if (route_prev_edges_[idx] == NO_EDGE || route_weights_[idx] > edge.weight) {
+            route_weights_[idx] = edge.weight;
+            route_prev_edges_[idx] = edge_id;
           }
         }
       }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to,
-                    const RouteInternalData& route_from, const RouteInternalData& route_to) {
-      auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-      const Weight candidate_weight = route_from.weight + route_to.weight;
-      if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-        route_relaxing = {
-            candidate_weight,
-            route_to.prev_edge
-                ? route_to.prev_edge
-                : route_from.prev_edge
-        };
-      }
-    }
-
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-      for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-        if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-          for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-            if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-              RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-            }
+    void RelaxRoutesInternalDataThroughVertex(VertexId vertex_through) {
+      const Weight* weights_through = route_weights_.data() + GetRouteIdx(vertex_through, 0);
+      const EdgeId* prev_edges_through = route_prev_edges_.data() + GetRouteIdx(vertex_through, 0);
+      for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+        if (vertex_from == vertex_through || !HasRoute(vertex_from, vertex_through)) {
+          continue;
+        }
+        const size_t idx_from = GetRouteIdx(vertex_from, vertex_through);
+        const Weight weight_from = route_weights_[idx_from];
+        const EdgeId prev_edge_from = route_prev_edges_[idx_from];
+        Weight* weights = route_weights_.data() + GetRouteIdx(vertex_from, 0);
+        EdgeId* prev_edges = route_prev_edges_.data() + GetRouteIdx(vertex_from, 0);
+        for (VertexId vertex_to = 0; vertex_to < vertex_count_; ++vertex_to) {
+          if (vertex_to == vertex_from || (vertex_to != vertex_through && prev_edges_through[vertex_to] == NO_EDGE)) {
+            continue;
+          }
+          const Weight candidate_weight = weight_from + weights_through[vertex_to];
+          if (prev_edges[vertex_to] == NO_EDGE || candidate_weight < weights[vertex_to]) {
+            weights[vertex_to] = candidate_weight;
+            prev_edges[vertex_to] = vertex_to == vertex_through ? prev_edge_from : prev_edges_through[vertex_to];
           }
         }
       }
@@ -101,14 +148,15 @@ namespace Graph {
   template <typename Weight, typename Extra>
   Router<Weight, Extra>::Router(const Graph& graph)
       : graph_(graph)
-      , routes_internal_data_(graph.GetVertexCount(), std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+      , vertex_count_(graph.GetVertexCount())
+      , route_weights_(vertex_count_ * vertex_count_, 0)
+      , route_prev_edges_(vertex_count_ * vertex_count_, NO_EDGE)
   {
     InitializeRoutesInternalData(graph);
 
-    LOG_DURATION("Router: relax routes");
-    const size_t vertex_count = graph.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-      RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+    TRACE("Router: relax routes");
+    for (VertexId vertex_through = 0; vertex_through < vertex_count_; ++vertex_through) {
+      RelaxRoutesInternalDataThroughVertex(vertex_through);
     }
   }
 
@@ -121,16 +169,15 @@ namespace Graph {
 
   template <typename Weight, typename Extra>
   std::optional<typename Router<Weight, Extra>::RouteInfo> Router<Weight, Extra>::BuildRoute(VertexId from, VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_[from][to];
-    if (!route_internal_data) {
+    if (!HasRoute(from, to)) {
       return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
+    const Weight weight = route_weights_[GetRouteIdx(from, to)];
     std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-         edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge) {
-      edges.push_back(*edge_id);
+    for (EdgeId edge_id = route_prev_edges_[GetRouteIdx(from, to)];
+         edge_id != NO_EDGE;
+         edge_id = route_prev_edges_[GetRouteIdx(from, graph_.GetEdge(edge_id).from)]) {
+      edges.push_back(edge_id);
     }
     std::reverse(std::begin(edges), std::end(edges));
 
@@ -140,6 +187,14 @@ namespace Graph {
     return RouteInfo{route_id, weight, route_edge_count};
   }
 
+  template <typename Weight, typename Extra>
+  std::optional<Weight> Router<Weight, Extra>::GetRouteWeight(VertexId from, VertexId to) const {
+    if (HasRoute(from, to)) {
+      return route_weights_[GetRouteIdx(from, to)];
+    }
+    return std::nullopt;
+  }
+
   template <typename Weight, typename Extra>
   EdgeId Router<Weight, Extra>::GetRouteEdgeId(RouteId route_id, size_t edge_idx) const {
     return expanded_routes_cache_.at(route_id)[edge_idx];
@@ -155,44 +210,206 @@ namespace Graph {
     expanded_routes_cache_.erase(route_id);
   }
 
+  template <typename Weight, typename Extra>
+  typename Router<Weight, Extra>::RouteInfo Router<Weight, Extra>::AddRoute(Weight weight, std::vector<EdgeId> edges) const {
+    const RouteId route_id = next_route_id_++;
+    const size_t route_edge_count = edges.size();
+    expanded_routes_cache_[route_id] = std::move(edges);
+    return RouteInfo{route_id, weight, route_edge_count};
+  }
+
+  template <typename Weight, typename Extra>
+  void Router<Weight, Extra>::AddEdge(EdgeId edge_id) {
+    const auto& edge = graph_.GetEdge(edge_id);
+    assert(edge.weight >= 0);
+    const Weight* weights_from_edge = route_weights_.data() + GetRouteIdx(edge.to, 0);
+    const EdgeId* prev_edges_from_edge = route_prev_edges_.data() + GetRouteIdx(edge.to, 0);
+    for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+      if (!HasRoute(vertex_from, edge.from)) {
+        continue;
+      }
+      const Weight weight_through = route_weights_[GetRouteIdx(vertex_from, edge.from)] + edge.weight;
+      Weight* weights = route_weights_.data() + GetRouteIdx(vertex_from, 0);
+      EdgeId* prev_edges = route_prev_edges_.data() + GetRouteIdx(vertex_from, 0);
+      for (VertexId vertex_to = 0; vertex_to < vertex_count_; ++vertex_to) {
+        if (vertex_to == vertex_from || (vertex_to != edge.to && prev_edges_from_edge[vertex_to] == NO_EDGE)) {
+          continue;
+        }
+        const Weight candidate_weight = weight_through + weights_from_edge[vertex_to];
+        if (prev_edges[vertex_to] == NO_EDGE || candidate_weight < weights[vertex_to]) {
+          weights[vertex_to] = candidate_weight;
+          prev_edges[vertex_to] = vertex_to == edge.to ? edge_id : prev_edges_from_edge[vertex_to];
+        }
+      }
+    }
+  }
+
+  template <typename Weight, typename Extra>
+  size_t Router<Weight, Extra>::GetMemoryUsage() const {
+    size_t size = Memory::GetHeapSize(route_weights_) + Memory::GetHeapSize(route_prev_edges_)
+        + Memory::GetHeapSize(expanded_routes_cache_);
+    for (const auto& [_, route] : expanded_routes_cache_) {
+      size += Memory::GetHeapSize(route);
+    }
+    return size;
+  }
+
+  template <typename Weight, typename Extra>
+  typename Router<Weight, Extra>::RowLayout Router<Weight, Extra>::BuildRowLayout() const {
+    const size_t edge_count = graph_.GetEdgeCount();
+    RowLayout layout;
+
+    layout.incoming_begin.assign(vertex_count_ + 1, 0);
+    layout.edge_from.resize(edge_count);
+    layout.edge_weight.resize(edge_count);
+    for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+      const auto& edge = graph_.GetEdge(edge_id);
+      ++layout.incoming_begin[edge.to + 1];
+      layout.edge_from[edge_id] = edge.from;
+      layout.edge_weight[edge_id] = edge.weight;
+    }
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+      layout.incoming_begin[vertex + 1] += layout.incoming_begin[vertex];
+    }
+    layout.incoming.resize(edge_count);
+    layout.edge_rank.resize(edge_count);
+    std::vector<size_t> filled(layout.incoming_begin.begin(), layout.incoming_begin.end() - 1);
+    for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+      const VertexId to = graph_.GetEdge(edge_id).to;
+      layout.edge_rank[edge_id] = filled[to] - layout.incoming_begin[to];
+      layout.incoming[filled[to]++] = edge_id;
+    }
+
+    layout.rank_offset.assign(vertex_count_ + 1, 0);
+    layout.rank_width.assign(vertex_count_, 0);
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+      size_t in_degree = layout.incoming_begin[vertex + 1] - layout.incoming_begin[vertex];
+      while (in_degree) {
+        ++layout.rank_width[vertex];
+        in_degree >>= 1;
+      }
+      layout.rank_offset[vertex + 1] = layout.rank_offset[vertex] + layout.rank_width[vertex];
+    }
+    return layout;
+  }
+
   template <typename Weight, typename Extra>
   void Router<Weight, Extra>::Serialize(SpravSerialize::Router& m) {
-    for (const auto& row : routes_internal_data_) {
-      auto& m_row = *m.add_row();
-      for (const auto& data_opt : row) {
-        auto& m_data = *m_row.add_data();
-        if (data_opt.has_value()) {
-          m_data.set_is_defined(true);
-          m_data.set_weight(data_opt->weight);
-          if (data_opt->prev_edge.has_value()) {
-            m_data.set_has_prev_edge(true);
-            m_data.set_prev_edge(data_opt->prev_edge.value());
+    const auto layout = BuildRowLayout();
+    m.mutable_row()->Reserve(vertex_count_);
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+      m.add_row(SerializeRow(layout, vertex));
+    }
+  }
+
+  template <typename Weight, typename Extra>
+  std::string Router<Weight, Extra>::SerializeRow(const RowLayout& layout, VertexId from) const {
+    const EdgeId* prev_edges = route_prev_edges_.data() + GetRouteIdx(from, 0);
+    std::string bytes((layout.rank_offset.back() + 7) / 8, '\0');
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+      if (prev_edges[vertex] == NO_EDGE) {
+        continue;
+      }
+      uint64_t value = layout.edge_rank[prev_edges[vertex]] + 1;
+      for (size_t bit = layout.rank_offset[vertex]; value; bit += 8 - bit % 8) {
+        bytes[bit / 8] |= static_cast<char>(value << (bit % 8));
+        value >>= 8 - bit % 8;
+      }
+    }
+    while (!bytes.empty() && !bytes.back()) {
+      bytes.pop_back();
+    }
+    return bytes;
+  }
+
+  template <typename Weight, typename Extra>
+  void Router<Weight, Extra>::ParseRow(const RowLayout& layout, VertexId from, const std::string& bytes, RowScratch& scratch) {
+    const size_t row_size = (layout.rank_offset.back() + 7) / 8;
+    if (bytes.size() > row_size) {
+      throw std::runtime_error("Corrupted router row");
+    }
+    // Dropped trailing bytes are zeros, and the padding lets every rank
+    // be read as one 64-bit word
+    auto& padded = scratch.padded;
+    padded.assign(row_size + sizeof(uint64_t), 0);
+    std::memcpy(padded.data(), bytes.data(), bytes.size());
+
+    Weight* weights = route_weights_.data() + GetRouteIdx(from, 0);
+    EdgeId* prev_edges = route_prev_edges_.data() + GetRouteIdx(from, 0);
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+      const uint8_t width = layout.rank_width[vertex];
+      if (!width || vertex == from) {
+        continue;
+      }
+      const size_t bit = layout.rank_offset[vertex];
+      uint64_t word;
+      std::memcpy(&word, padded.data() + bit / 8, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      word = __builtin_bswap64(word);
+#endif
+      const size_t value = (word >> (bit % 8)) & ((uint64_t(1) << width) - 1);
+      if (!value) {
+        continue;
+      }
+      if (value > layout.incoming_begin[vertex + 1] - layout.incoming_begin[vertex]) {
+        throw std::runtime_error("Corrupted router row");
+      }
+      prev_edges[vertex] = layout.incoming[layout.incoming_begin[vertex] + value - 1];
+    }
+
+    // Weights are summed along the last edges, from the source outwards
+    auto& resolved = scratch.resolved;
+    auto& chain = scratch.chain;
+    resolved.assign(vertex_count_, 0);
+    resolved[from] = 1;
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+      for (VertexId step = vertex; !resolved[step]; step = layout.edge_from[prev_edges[step]]) {
+        if (prev_edges[step] == NO_EDGE) {
+          if (step != vertex) {
+            throw std::runtime_error("Corrupted router row");
           }
+          break;
+        }
+        if (chain.size() == vertex_count_) {
+          throw std::runtime_error("Corrupted router row");
         }
+        chain.push_back(step);
+      }
+      for (; !chain.empty(); chain.pop_back()) {
+        const VertexId step = chain.back();
+        weights[step] = weights[layout.edge_from[prev_edges[step]]] + layout.edge_weight[prev_edges[step]];
+        resolved[step] = 1;
       }
     }
   }
 
   template <typename Weight, typename Extra>
   void Router<Weight, Extra>::ParseFrom(const SpravSerialize::Router& m) {
-    LOG_DURATION("Router parsefrom");
-    routes_internal_data_.reserve(m.row().size());
-    for (const auto& m_row : m.row()) {
-      std::vector<std::optional<RouteInternalData>> row;
-      row.reserve(m_row.data().size());
-      for (const auto& m_data : m_row.data()) {
-        std::optional<RouteInternalData> data_opt;
-        if (m_data.is_defined()) {
-          RouteInternalData data;
-          data.weight = m_data.weight();
-          if (m_data.has_prev_edge()) {
-            data.prev_edge = m_data.prev_edge();
-          }
-          data_opt = std::move(data);
+    TRACE("Router parsefrom");
+    vertex_count_ = graph_.GetVertexCount();
+    if (static_cast<size_t>(m.row_size()) != vertex_count_) {
+      throw std::runtime_error("Router rows do not match the graph");
+    }
+    const auto layout = BuildRowLayout();
+    route_weights_.assign(vertex_count_ * vertex_count_, 0);
+    route_prev_edges_.assign(vertex_count_ * vertex_count_, NO_EDGE);
+
+    // Rows are independent, so they are decoded by contiguous pages in parallel
+    const size_t threads_count = std::max(1u, std::thread::hardware_concurrency());
+    const size_t page_size = std::max<size_t>(16, (vertex_count_ + threads_count - 1) / threads_count);
+
+    std::vector<std::future<void>> futures;
+    for (size_t begin = 0; begin < vertex_count_; begin += page_size) {
+      const size_t end = std::min(vertex_count_, begin + page_size);
+      futures.push_back(std::async(std::launch::async, [this, &m, &layout, begin, end] {
+        RowScratch scratch;
+        for (VertexId vertex = begin; vertex < end; ++vertex) {
+          ParseRow(layout, vertex, m.row(vertex), scratch);
         }
-        row.push_back(std::move(data_opt));
-      }
-      routes_internal_data_.push_back(std::move(row));
+      }));
+    }
+    for (auto& f : futures) {
+      f.get();
     }
   }
 
@@ -7,3 +7,15 @@ RoutingSettings::RoutingSettings(const Json::Dict& dict) {
   bus_velocity = dict.at("bus_velocity").AsDouble() * 1000.0 / 60.0;
   pedestrian_velocity = dict.at("pedestrian_velocity").AsDouble() * 1000.0 / 60.0;
 }
+
+RoutingSettings::RoutingSettings(const SpravSerialize::RoutingSettings& m) {
+  bus_wait_time = m.bus_wait_time();
+  bus_velocity = m.bus_velocity();
+  pedestrian_velocity = m.pedestrian_velocity();
+}
+
+void RoutingSettings::Serialize(SpravSerialize::RoutingSettings& m) const {
+  m.set_bus_wait_time(bus_wait_time);
+  m.set_bus_velocity(bus_velocity);
+  m.set_pedestrian_velocity(pedestrian_velocity);
+}
@@ -1,12 +1,16 @@
 #pragma once
 
 #include "json.h"
+#include "routing_settings.pb.h"
 
 struct RoutingSettings {
   RoutingSettings() = default;
   RoutingSettings(const Json::Dict& dict);
+  RoutingSettings(const SpravSerialize::RoutingSettings& m);
+
+  void Serialize(SpravSerialize::RoutingSettings& m) const;
 
   double bus_wait_time = 1; // min
   double bus_velocity = 1; // meters / min
   double pedestrian_velocity = 1; // meters / min
-};
\ No newline at end of file
+};
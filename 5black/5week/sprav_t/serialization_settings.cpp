@@ -2,4 +2,7 @@
 
 SerializationSettings::SerializationSettings(const Json::Dict& dict) {
   file = dict.at("file").AsString();
+  if (auto it = dict.find("output_file"); it != dict.end()) {
+    output_file = it->second.AsString();
+  }
 }
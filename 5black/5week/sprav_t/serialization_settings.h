@@ -9,4 +9,5 @@ struct SerializationSettings {
   SerializationSettings(const Json::Dict& dict);
 
   std::string file;
+  std::string output_file;
 };
\ No newline at end of file
@@ -64,13 +64,22 @@ Sprav::Route::Route(const Sprav& sprav, RouteInfoOpt info_opt, const Time& curre
   if (info_opt_.has_value()) {
     typename RouteInfoOpt::value_type& info = info_opt_.value();
     total_time_ = info.weight;
+    reserve(info.edge_count + 1);
+
     std::string_view last_bus = {};
     double bus_total_time = 0;
     size_t bus_span_count = 0;
-    std::list<size_t> bus_stops;
+    size_t bus_stops_begin = 0;
+    auto push_bus = [&]() {
+      if (!last_bus.empty()) {
+        push_back({RoutePartType::RIDE_BUS, bus_total_time, last_bus, 0, bus_span_count, bus_stops_begin, stops_.size()});
+        last_bus = {};
+      }
+    };
+
     optional<size_t> company_id;
     for (size_t idx = 0; idx < info.edge_count; ++idx) {
-      auto edge = sprav_.GetRouter()->GetRouteEdge(info.id, idx);
+      const auto& edge = sprav_.GetRouter()->GetRouteEdge(info.id, idx);
       switch (edge.extra.type) {
         default:
         case RoutePartType::NOOP:
@@ -81,36 +90,22 @@ Sprav::Route::Route(const Sprav& sprav, RouteInfoOpt info_opt, const Time& curre
           if (name == last_bus) {
             bus_total_time += edge.weight;
             bus_span_count += edge.extra.span_count;
-            bus_stops.insert(bus_stops.end(), edge.extra.stops.begin(), edge.extra.stops.end());
-          } else if (last_bus != name) {
-            if (!last_bus.empty()) {
-              push_back({RoutePartType::RIDE_BUS, bus_total_time, last_bus, 0, bus_span_count, bus_stops});
-            }
+          } else {
+            push_bus();
             last_bus = name;
             bus_total_time = edge.weight;
             bus_span_count = edge.extra.span_count;
-            bus_stops.assign(edge.extra.stops.begin(), edge.extra.stops.end());
+            bus_stops_begin = stops_.size();
           }
+          stops_.insert(stops_.end(), edge.extra.stops.begin(), edge.extra.stops.end());
           break;
         }
         case RoutePartType::WAIT_BUS:
-          if (!last_bus.empty()) {
-            push_back({RoutePartType::RIDE_BUS, bus_total_time, last_bus, 0, bus_span_count, bus_stops});
-            last_bus = {};
-            bus_total_time = 0;
-            bus_span_count = 0;
-            bus_stops.clear();
-          }
+          push_bus();
           push_back({RoutePartType::WAIT_BUS, edge.weight, sprav_.GetStop(edge.extra.id).name});
           break;
         case RoutePartType::WALK_TO_COMPANY:
-          if (!last_bus.empty()) {
-            push_back({RoutePartType::RIDE_BUS, bus_total_time, last_bus, 0, bus_span_count, bus_stops});
-            last_bus = {};
-            bus_total_time = 0;
-            bus_span_count = 0;
-            bus_stops.clear();
-          }
+          push_bus();
           company_id = edge.extra.company_id;
           push_back({
             RoutePartType::WALK_TO_COMPANY,
@@ -121,9 +116,7 @@ Sprav::Route::Route(const Sprav& sprav, RouteInfoOpt info_opt, const Time& curre
           break;
       }
     }
-    if (!last_bus.empty()) {
-      push_back({RoutePartType::RIDE_BUS, bus_total_time, last_bus, 0, bus_span_count, bus_stops});
-    }
+    push_bus();
 
     if (company_id) {
       if (auto wait_opt = sprav_.GetPages()->GetWaitTime(company_id.value(), current_time + info.weight); wait_opt) {
@@ -141,6 +134,10 @@ Sprav::Route::Route(const Sprav& sprav, RouteInfoOpt info_opt, const Time& curre
   }
 }
 
+Sprav::StopsRange Sprav::Route::GetStops(const RouteItem& item) const {
+  return {stops_.begin() + item.stops_begin, stops_.begin() + item.stops_end};
+}
+
 double Sprav::Route::GetTotalTime() const {
   return total_time_;
 }
@@ -151,7 +148,8 @@ Sprav::Route::operator bool() const {
 
 Json::Node Sprav::Route::AsJson() const {
   Json::Array items;
-  for (auto part : *this) {
+  items.reserve(size());
+  for (const auto& part : *this) {
     if (part.type == RoutePartType::NOOP) {
       continue;
     }
@@ -226,10 +224,22 @@ void Sprav::AddBus(std::string_view name, const std::list<std::string> stops, bo
   Pimpl()->AddBus(move(name), stops, is_roundtrip);
 }
 
+void Sprav::RemoveStop(std::string_view name) {
+  Pimpl()->RemoveStop(name);
+}
+
+void Sprav::RemoveBus(std::string_view name) {
+  Pimpl()->RemoveBus(name);
+}
+
 void Sprav::BuildBase() {
   Pimpl()->BuildBase();
 }
 
+void Sprav::UpdateBase() {
+  Pimpl()->UpdateBase();
+}
+
 const Stop& Sprav::GetStop(size_t id) const {
   return Pimpl()->GetStop(id);
 }
@@ -262,10 +272,26 @@ Sprav::Route Sprav::FindRoute(std::string_view from, std::string_view to) const
   return Pimpl()->FindRoute(from, to);
 }
 
+std::vector<Sprav::Route> Sprav::FindRouteAlternatives(std::string_view from, std::string_view to, size_t max_alternatives) const {
+  return Pimpl()->FindRouteAlternatives(from, to, max_alternatives);
+}
+
 Sprav::Route Sprav::FindRouteToCompany(std::string_view from, const YellowPages::Query& query, const Time& time) const {
   return Pimpl()->FindRouteToCompany(from, query, time);
 }
 
+Sprav::RouteMatrix Sprav::FindRouteMatrix(const std::vector<std::string>& from, const std::vector<std::string>& to, bool with_routes) const {
+  return Pimpl()->FindRouteMatrix(from, to, with_routes);
+}
+
+std::optional<Sprav::Reachable> Sprav::FindReachable(std::string_view from, double max_time, const std::optional<YellowPages::Query>& query) const {
+  return Pimpl()->FindReachable(from, max_time, query);
+}
+
+GeoIndex::Found Sprav::FindNearestStops(GeoIndex::Point point, size_t count, std::optional<double> radius) const {
+  return Pimpl()->FindNearestStops(point, count, radius);
+}
+
 std::string Sprav::GetMap() const {
   return Pimpl()->GetMap();
 }
@@ -274,10 +300,30 @@ std::string Sprav::GetRouteMap(const Route& route) const {
   return Pimpl()->GetRouteMap(route);
 }
 
+Json::Raw Sprav::GetMapJson() const {
+  return Pimpl()->GetMapJson();
+}
+
+Json::Raw Sprav::GetRouteMapJson(const Route& route) const {
+  return Pimpl()->GetRouteMapJson(route);
+}
+
 Pages::Companies Sprav::FindCompanies(const YellowPages::Query& query) {
   return Pimpl()->FindCompanies(query);
 }
 
+SuggestIndex::Found Sprav::SuggestCompanies(string_view query, size_t count, size_t max_distance) const {
+  return Pimpl()->SuggestCompanies(query, count, max_distance);
+}
+
+MemoryReport Sprav::GetMemoryReport() const {
+  return Pimpl()->GetMemoryReport();
+}
+
+vector<Sprav::CacheStats> Sprav::GetCacheStats() const {
+  return Pimpl()->GetCacheStats();
+}
+
 const Sprav::PImpl* Sprav::Pimpl() const {
   return pimpl_.get();
 }
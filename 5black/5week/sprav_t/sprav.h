@@ -2,12 +2,18 @@
 
 #include <list>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "bus.h"
 #include "database_queries.pb.h"
+#include "dijkstra.h"
+#include "geo_index.h"
+#include "memory_report.h"
 #include "pages.h"
 #include "render_settings.h"
 #include "router.h"
@@ -31,7 +37,7 @@ class Sprav {
     size_t id = 0;
     size_t span_count = 0;
     size_t company_id = 0;
-    std::list<size_t> stops = {};
+    std::vector<size_t> stops = {};
 
     void Serialize(SpravSerialize::Graph::Edge& m) const;
     static RouteExtra ParseFrom(const SpravSerialize::Graph::Edge& m);
@@ -39,6 +45,7 @@ class Sprav {
 
   using Graph = ::Graph::DirectedWeightedGraph<double, RouteExtra>;
   using Router = ::Graph::Router<double, RouteExtra>;
+  using Dijkstra = ::Graph::Dijkstra<double, RouteExtra>;
   using RouteInfoOpt = std::optional<typename Router::RouteInfo>;
   using Edge = typename Router::Edge;
 
@@ -50,10 +57,14 @@ class Sprav {
     size_t company_id = 0;
     size_t span_count = 0;
 
-    std::list<size_t> stops = {};
+    // Bus stops of the item, [stops_begin, stops_end) in the route stops
+    size_t stops_begin = 0;
+    size_t stops_end = 0;
   };
 
-  class Route : public std::list<RouteItem> {
+  using StopsRange = Range<std::vector<size_t>::const_iterator>;
+
+  class Route : public std::vector<RouteItem> {
    private:
     friend class Sprav;
     Route(const Sprav& sprav, RouteInfoOpt info, const Time& current_time);
@@ -62,18 +73,47 @@ class Sprav {
     double GetTotalTime() const;
     operator bool() const;
 
+    StopsRange GetStops(const RouteItem& item) const;
+
     Json::Node AsJson() const;
 
    private:
     const Sprav& sprav_;
     RouteInfoOpt info_opt_;
     double total_time_;
+    std::vector<size_t> stops_;
+  };
+
+  // Stops and companies reachable from a stop, ordered by arrival time
+  struct Reachable {
+    std::vector<std::pair<size_t, double>> stops;
+    std::vector<std::pair<size_t, double>> companies;
+  };
+
+  // Travel times between every source and target, row by row;
+  // routes are filled in the same order only when requested
+  struct RouteMatrix {
+    size_t sources_count = 0;
+    size_t targets_count = 0;
+    std::vector<std::optional<double>> times;
+    std::vector<Route> routes;
+  };
+
+  struct CacheStats {
+    std::string name;
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t count = 0;
+    size_t bytes = 0;
   };
 
   using StopNames = std::deque<std::string>;
   using BusNames = std::deque<std::string>;
 
  public:
+  static constexpr size_t MAX_ROUTE_ALTERNATIVES = 8;
+
   Sprav();
   ~Sprav();
 
@@ -93,7 +133,11 @@ class Sprav {
   void AddStop(std::string_view name, double lat, double lon, const std::unordered_map<std::string, int>& distances);
   void AddBus(std::string_view name, const std::list<std::string> stops, bool is_roundtrip);
 
+  void RemoveStop(std::string_view name);
+  void RemoveBus(std::string_view name);
+
   void BuildBase();
+  void UpdateBase();
 
   const Stop& GetStop(size_t id) const;
   const Bus& GetBus(size_t id) const;
@@ -106,12 +150,30 @@ class Sprav {
 
   Router* GetRouter() const;
   Route FindRoute(std::string_view from, std::string_view to) const;
+  // Up to max_alternatives, at most MAX_ROUTE_ALTERNATIVES, routes other
+  // than the best one, each sharing a limited part of its rides with the
+  // best and the others
+  std::vector<Route> FindRouteAlternatives(std::string_view from, std::string_view to, size_t max_alternatives) const;
   Route FindRouteToCompany(std::string_view from, const YellowPages::Query& query, const Time& time) const;
+  RouteMatrix FindRouteMatrix(const std::vector<std::string>& from, const std::vector<std::string>& to, bool with_routes) const;
+  std::optional<Reachable> FindReachable(std::string_view from, double max_time, const std::optional<YellowPages::Query>& query) const;
+  // Stop ids with distances in meters, nearest first
+  GeoIndex::Found FindNearestStops(GeoIndex::Point point, size_t count, std::optional<double> radius) const;
 
   std::string GetMap() const;
   std::string GetRouteMap(const Route& route) const;
+  // The same maps printed as JSON strings. They are cached, so responses
+  // share one buffer per distinct map.
+  Json::Raw GetMapJson() const;
+  Json::Raw GetRouteMapJson(const Route& route) const;
 
   Pages::Companies FindCompanies(const YellowPages::Query& query);
+  // Company ids by a name prefix, each with its number of typos
+  SuggestIndex::Found SuggestCompanies(std::string_view query, size_t count, size_t max_distance) const;
+
+  MemoryReport GetMemoryReport() const;
+  // Hits and misses of the route caches since the catalog was created
+  std::vector<CacheStats> GetCacheStats() const;
 
  private:
   class PImpl;
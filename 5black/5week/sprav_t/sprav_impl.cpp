@@ -1,14 +1,19 @@
 #include "sprav_impl.h"
 
-#include <google/protobuf/arena.h>
-
 #include <algorithm>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <set>
+#include <sstream>
 #include <stdexcept>
+#include <thread>
 #include <unordered_set>
 
-#include "profile.h"
+#include "hashing.h"
+#include "paginator.h"
+#include "trace.h"
 #include "sprav_mapper.h"
 #include "string_stream_utils.h"
 #include "transport_catalog.pb.h"
@@ -17,146 +22,274 @@ using namespace std;
 
 namespace {
 
-template <typename Node, typename Container, typename Names>
-Node& GetNode(Container& c, Names& n, string_view name, optional<Node> pre_node) {
-  auto it = c.find(name);
-  if (it != c.end()) {
+const size_t MIN_PAGE_SIZE = 16;
+const size_t ROUTE_CACHE_MAX_SIZE = 64 << 20;
+const size_t ROUTE_MAP_CACHE_MAX_SIZE = 64 << 20;
+const size_t NO_STOP = numeric_limits<size_t>::max();
+
+// Adding an edge to the router relaxes all pairs, O(V^2), while a new
+// router costs O(V^3): more new edges than vertices are cheaper rebuilt
+const double ROUTER_REBUILD_EDGES_PER_VERTEX = 1.0;
+
+// Alternative routes: every time a ride segment is used by a found route,
+// rides over it get this share of their time added
+const double ALTERNATIVE_PENALTY = 0.5;
+const double ALTERNATIVE_MAX_STRETCH = 1.5;
+const double ALTERNATIVE_MAX_SHARED = 0.7;
+const size_t ALTERNATIVE_ATTEMPTS_PER_ROUTE = 3;
+
+// Splits items into at most hardware_concurrency() contiguous pages and
+// runs func on every page asynchronously. Futures follow the page order.
+template <typename C, typename Func>
+auto ProcessPages(C& items, Func func) {
+  const size_t threads_count = max(1u, thread::hardware_concurrency());
+  const size_t page_size = max(MIN_PAGE_SIZE, (items.size() + threads_count - 1) / threads_count);
+
+  vector<future<decltype(func(*Paginate(items, page_size).begin()))>> futures;
+  for (auto page : Paginate(items, page_size)) {
+    futures.push_back(async(launch::async, func, page));
+  }
+  return futures;
+}
+
+template <typename NewIds>
+optional<size_t> FindId(const NameIndex& index, const NewIds& new_ids, string_view name) {
+  if (auto id = index.Find(name); id) {
+    return id;
+  }
+  if (auto it = new_ids.find(name); it != new_ids.end()) {
     return it->second;
   }
+  return nullopt;
+}
 
-  if (pre_node) {
-    string_view stored_name = n[pre_node.value().id] = string(name);
-    Node& node = c[stored_name] = std::move(pre_node.value());
-    node.name = stored_name;
-    return node;
+template <typename Nodes, typename Names, typename NewIds>
+auto& GetNode(Nodes& nodes, Names& names, const NameIndex& index, NewIds& new_ids, string_view name) {
+  if (auto id = FindId(index, new_ids, name); id) {
+    return nodes[*id];
   }
 
-  string_view stored_name = n.emplace_back(string(name));
-  Node& node = c[stored_name];
-  node.id = n.size() - 1;
+  string_view stored_name = names.emplace_back(string(name));
+  auto& node = nodes.emplace_back();
+  node.id = nodes.size() - 1;
   node.name = stored_name;
+  new_ids.emplace(stored_name, node.id);
   return node;
 }
 
-struct Catalog {
-  SpravSerialize::TransportCatalog* p;
-  google::protobuf::Arena arena;
-
-  Catalog() {
-    p = google::protobuf::Arena::CreateMessage<SpravSerialize::TransportCatalog>(&arena);
+// Places parsed nodes at their ids, so loading hashes no names. Names
+// are moved out of the messages, which are freed on return.
+template <typename Nodes, typename Names, typename Messages>
+void ParseNodes(Nodes& nodes, Names& names, Messages messages) {
+  using Node = typename Nodes::value_type;
+  nodes.resize(messages.size());
+  names.resize(messages.size());
+  for (auto& m : messages) {
+    Node node = Node::Parse(m);
+    const size_t id = node.id;
+    node.name = names[id] = move(*m.mutable_name());
+    nodes[id] = move(node);
   }
+}
 
-  ~Catalog() {
-    LOG_DURATION("Transport catalog destruct");
-    arena.Reset();
+// Takes a section out of the parsed catalog, so it is freed as soon as
+// its runtime structure is built
+template <typename Message>
+unique_ptr<Message> TakeSection(Message* released) {
+  return released ? unique_ptr<Message>(released) : make_unique<Message>();
+}
+
+// The same for repeated sections: clear_*() would keep the elements
+// allocated for reuse
+template <typename Messages>
+Messages TakeRepeatedSection(Messages* messages) {
+  Messages taken;
+  taken.Swap(messages);
+  return taken;
+}
+
+}
+
+// Approximate heap footprint of a cached route
+size_t Sprav::PImpl::GetRouteCacheEntrySize(const RouteKey& key, const Route& route) {
+  size_t size = sizeof(key) + key.query.capacity() + sizeof(route) + route.capacity() * sizeof(RouteItem);
+  for (const auto& item : route) {
+    size += (item.stops_end - item.stops_begin) * sizeof(size_t);
   }
-};
+  return size;
+}
 
-Catalog catalog;
+size_t Sprav::PImpl::GetRouteMapCacheEntrySize(const string& key, const Json::Raw& map) {
+  return sizeof(key) + key.capacity() + sizeof(map) + map.text->capacity();
+}
+
+bool Sprav::PImpl::RouteKey::operator==(const RouteKey& other) const {
+  return from == other.from && to == other.to && time == other.time && query == other.query;
+}
 
+size_t Sprav::PImpl::RouteKeyHasher::operator()(const RouteKey& key) const {
+  size_t seed = 0;
+  HashCombine(seed, hash<size_t>{}(key.from));
+  HashCombine(seed, hash<size_t>{}(key.to));
+  HashCombine(seed, hash<string>{}(key.query));
+  HashCombine(seed, hash<double>{}(key.time));
+  return seed;
 }
 
 Sprav::PImpl::PImpl(Sprav* sprav)
-  : sprav_(sprav) {}
+  : sprav_(sprav)
+  , route_cache_(ROUTE_CACHE_MAX_SIZE, GetRouteCacheEntrySize)
+  , route_map_cache_(ROUTE_MAP_CACHE_MAX_SIZE, GetRouteMapCacheEntrySize)
+{}
+
+void Sprav::PImpl::ClearCaches() {
+  route_cache_.Clear();
+  route_map_cache_.Clear();
+  lock_guard g(map_json_m_);
+  map_json_.reset();
+}
 
 void Sprav::PImpl::Serialize() {
-  LOG_DURATION("Sprav::Serialize");
+  TRACE("Sprav::Serialize");
+  SpravSerialize::TransportCatalog catalog;
 
   {
-    LOG_DURATION("Sprav::Serialize stops");
-    for (const auto& [_, stop] : stops_) {
-      stop.SerializeTo(*catalog.p->add_stop());
+    TRACE("Sprav::Serialize stops");
+    for (const auto& stop : stops_) {
+      stop.SerializeTo(*catalog.add_stop());
     }
   }
 
   {
-    LOG_DURATION("Sprav::Serialize buses");
-    for (const auto& [_, bus] : buses_) {
-      bus.SerializeTo(*catalog.p->add_bus());
+    TRACE("Sprav::Serialize buses");
+    for (const auto& bus : buses_) {
+      bus.SerializeTo(*catalog.add_bus());
     }
   }
 
   {
-    LOG_DURATION("Sprav::Serialize graph");
-    router_graph_->Serialize(*catalog.p->mutable_graph());
+    TRACE("Sprav::Serialize name index");
+    stop_index_.Serialize(*catalog.mutable_stop_index());
+    bus_index_.Serialize(*catalog.mutable_bus_index());
   }
 
   {
-    LOG_DURATION("Sprav::Serialize router");
-    router_->Serialize(*catalog.p->mutable_router());
+    TRACE("Sprav::Serialize geo index");
+    stop_geo_index_.Serialize(*catalog.mutable_stop_geo_index());
   }
 
   {
-    LOG_DURATION("Sprav::Serialize render settings");
-    render_settings_.Serialize(*catalog.p->mutable_render_settings());
+    TRACE("Sprav::Serialize graph");
+    router_graph_->Serialize(*catalog.mutable_graph());
   }
 
   {
-    LOG_DURATION("Sprav::Serialize mapper");
-    mapper_->Serialize(*catalog.p->mutable_mapper());
+    TRACE("Sprav::Serialize router");
+    router_->Serialize(*catalog.mutable_router());
   }
 
   {
-    LOG_DURATION("Sprav::Serialize pages");
-    pages_->Serialize(*catalog.p->mutable_pages());
+    TRACE("Sprav::Serialize routing settings");
+    routing_settings_.Serialize(*catalog.mutable_routing_settings());
   }
 
   {
-    LOG_DURATION("Sprav::Serialize materialization");
-    ofstream ofile(serialization_settings_.file, ios::binary | ios::trunc);
-    catalog.p->SerializeToOstream(&ofile);
+    TRACE("Sprav::Serialize render settings");
+    render_settings_.Serialize(*catalog.mutable_render_settings());
+  }
+
+  {
+    TRACE("Sprav::Serialize mapper");
+    mapper_->Serialize(*catalog.mutable_mapper());
+  }
+
+  {
+    TRACE("Sprav::Serialize pages");
+    pages_->Serialize(*catalog.mutable_pages());
+  }
+
+  {
+    TRACE("Sprav::Serialize materialization");
+    const string& file = serialization_settings_.output_file.empty()
+      ? serialization_settings_.file
+      : serialization_settings_.output_file;
+    ofstream ofile(file, ios::binary | ios::trunc);
+    catalog.SerializeToOstream(&ofile);
   }
 }
 
 
 void Sprav::PImpl::Deserialize() {
-  LOG_DURATION("Sprav::Deserialize");
+  TRACE("Sprav::Deserialize");
+  ClearCaches();
 
+  // Sections are heap messages, not arena ones: each is released right
+  // after use and Pages takes its database over without a copy
+  SpravSerialize::TransportCatalog catalog;
   {
-    LOG_DURATION("Sprav::Deserialize parsing");
+    TRACE("Sprav::Deserialize parsing");
     ifstream ifile(serialization_settings_.file, ios::binary);
-    catalog.p->ParseFromIstream(&ifile);
+    catalog.ParseFromIstream(&ifile);
   }
 
   {
-    LOG_DURATION("Sprav::Deserialize render settings");
-    render_settings_ = RenderSettings(catalog.p->render_settings());
+    TRACE("Sprav::Deserialize routing settings");
+    routing_settings_ = RoutingSettings(catalog.routing_settings());
   }
 
   {
-    LOG_DURATION("Sprav::Deserialize stops");
-    stop_names_.resize(catalog.p->stop().size());
-    for (const auto& stop : catalog.p->stop()) {
-      AddStop(stop.name(), Stop::Parse(stop));
-    }
+    TRACE("Sprav::Deserialize render settings");
+    render_settings_ = RenderSettings(catalog.render_settings());
   }
 
   {
-    LOG_DURATION("Sprav::Deserialize buses");
-    bus_names_.resize(catalog.p->bus().size());
-    for (const auto& bus : catalog.p->bus()) {
-      AddBus(bus.name(), Bus::Parse(bus));
+    TRACE("Sprav::Deserialize stops");
+    ParseNodes(stops_, stop_names_, TakeRepeatedSection(catalog.mutable_stop()));
+    for (auto& stop : stops_) {
+      for (auto [other_id, distance] : stop.road_distances) {
+        stop.distances[other_id] = distance;
+        Stop& other = stops_[other_id];
+        if (other.road_distances.count(stop.id) == 0) {
+          other.distances[stop.id] = distance;
+        }
+      }
     }
   }
 
   {
-    LOG_DURATION("Sprav::Deserialize graph");
-    router_graph_ = make_shared<Graph>(catalog.p->graph());
+    TRACE("Sprav::Deserialize buses");
+    ParseNodes(buses_, bus_names_, TakeRepeatedSection(catalog.mutable_bus()));
   }
 
   {
-    LOG_DURATION("Sprav::Deserialize router");
-    router_ = make_shared<Router>(*router_graph_.get(), catalog.p->router());
+    TRACE("Sprav::Deserialize name index");
+    stop_index_ = NameIndex(*TakeSection(catalog.release_stop_index()));
+    bus_index_ = NameIndex(*TakeSection(catalog.release_bus_index()));
   }
 
   {
-    LOG_DURATION("Sprav::Deserialize mapper");
-    mapper_ = make_shared<SpravMapper>(sprav_, catalog.p->mapper());
+    TRACE("Sprav::Deserialize geo index");
+    stop_geo_index_ = GeoIndex(*TakeSection(catalog.release_stop_geo_index()));
   }
 
   {
-    LOG_DURATION("Sprav::Deserialize pages");
-    pages_ = make_shared<Pages>(catalog.p->pages());
+    TRACE("Sprav::Deserialize graph");
+    router_graph_ = make_shared<Graph>(*TakeSection(catalog.release_graph()));
+  }
+
+  {
+    TRACE("Sprav::Deserialize router");
+    router_ = make_shared<Router>(*router_graph_.get(), *TakeSection(catalog.release_router()));
+  }
+
+  {
+    TRACE("Sprav::Deserialize mapper");
+    mapper_ = make_shared<SpravMapper>(sprav_, *TakeSection(catalog.release_mapper()));
+  }
+
+  {
+    TRACE("Sprav::Deserialize pages");
+    pages_ = make_shared<Pages>(move(*TakeSection(catalog.release_pages())));
   }
 }
 
@@ -185,37 +318,158 @@ PagesPtr Sprav::PImpl::GetPages() const {
 }
 
 void Sprav::PImpl::BuildBase() {
-  LOG_DURATION("Sprav::BuildBase");
-  for (auto& [_, bus] : buses_) {
-    CalcBusStats(bus);
+  TRACE("Sprav::BuildBase");
+  BuildNameIndex();
+  BuildGeoIndex();
+
+  {
+    TRACE("Sprav::BuildBase bus stats");
+    vector<Bus*> buses;
+    buses.reserve(buses_.size());
+    for (auto& bus : buses_) {
+      buses.push_back(&bus);
+    }
+    CalcBusStats(buses);
   }
+
+  // Projection only reads stops, buses and pages, so it runs alongside
+  // graph and router construction.
+  auto mapper = BuildMapperAsync();
   BuildGraph();
   BuildRouter();
 
-  mapper_ = make_shared<SpravMapper>(sprav_);
+  mapper_ = mapper.get();
+  ClearCaches();
+  changes_ = {};
+}
+
+void Sprav::PImpl::UpdateBase() {
+  TRACE("Sprav::UpdateBase");
+
+  // Removals renumber stops and buses, so the base is built anew
+  if (!changes_.removed_stops.empty() || !changes_.removed_buses.empty()) {
+    Compact();
+    BuildBase();
+    return;
+  }
+
+  if (changes_.stops.empty() && changes_.buses.empty()) {
+    return;
+  }
+
+  BuildNameIndex();
+  if (!changes_.stops.empty()) {
+    BuildGeoIndex();
+  }
+
+  {
+    TRACE("Sprav::UpdateBase bus stats");
+    unordered_set<size_t> affected_buses = changes_.buses;
+    for (auto stop_id : changes_.stops) {
+      const auto& stop_buses = GetStop(stop_id).buses;
+      affected_buses.insert(stop_buses.begin(), stop_buses.end());
+    }
+    vector<Bus*> buses;
+    buses.reserve(affected_buses.size());
+    for (auto bus_id : affected_buses) {
+      buses.push_back(&buses_[bus_id]);
+    }
+    CalcBusStats(buses);
+  }
+
+  // Edges can't be taken out of the all-pairs router, only added: a
+  // changed bus, like new stops or distances, rebuilds graph and router
+  auto mapper = BuildMapperAsync();
+  if (changes_.stops_added || changes_.buses_changed || changes_.distances_changed) {
+    BuildGraph();
+    BuildRouter();
+  } else if (changes_.buses_added) {
+    ExtendGraph(changes_.buses);
+  }
+
+  mapper_ = mapper.get();
+  ClearCaches();
+  changes_ = {};
 }
 
 void Sprav::PImpl::AddStop(std::string_view name, double lat, double lon, const unordered_map<string, int>& distances) {
-  Stop& s = GetStop(name);
+  const size_t stops_count = stops_.size();
+  const size_t id = GetStop(name).id;
+
+  // Other stops may be added here, so s is taken after them
+  unordered_map<size_t, int> road_distances;
+  for (auto [other_name, distance]: distances) {
+    road_distances[GetStop(other_name).id] = distance;
+  }
+
+  Stop& s = stops_[id];
   s.lat = lat;
   s.lon = lon;
 
-  for (auto [other_name, distance]: distances) {
-    Stop& other = GetStop(other_name);
-    s.distances[other.id] = distance;
+  unordered_set<size_t> touched;
+  for (auto [other_id, _] : s.road_distances) {
+    touched.insert(other_id);
+  }
+  for (auto [other_id, _] : road_distances) {
+    touched.insert(other_id);
+  }
+  s.road_distances = move(road_distances);
 
-    if (other.distances.find(s.id) == other.distances.end()) {
-      other.distances[s.id] = distance;
+  for (auto other_id : touched) {
+    Stop& other = stops_[other_id];
+    if (UpdateDistance(s, other) | UpdateDistance(other, s)) {
+      changes_.distances_changed = true;
     }
   }
+
+  changes_.stops.insert(s.id);
+  changes_.removed_stops.erase(string(name));
+  if (stops_.size() != stops_count) {
+    changes_.stops_added = true;
+  }
 }
 
-void Sprav::PImpl::AddStop(std::string_view name, Stop&& stop) {
-  GetStop(name, std::move(stop));
+bool Sprav::PImpl::UpdateDistance(Stop& from, const Stop& to) {
+  optional<int> distance;
+  if (auto it = from.road_distances.find(to.id); it != from.road_distances.end()) {
+    distance = it->second;
+  } else if (auto it = to.road_distances.find(from.id); it != to.road_distances.end()) {
+    distance = it->second;
+  }
+
+  auto it = from.distances.find(to.id);
+  if (!distance) {
+    if (it == from.distances.end()) {
+      return false;
+    }
+    from.distances.erase(it);
+    return true;
+  }
+
+  if (it == from.distances.end()) {
+    from.distances[to.id] = *distance;
+    return false;
+  }
+  const bool changed = it->second != *distance;
+  it->second = *distance;
+  return changed;
 }
 
 void Sprav::PImpl::AddBus(std::string_view name, const std::list<std::string> stops, bool is_roundtrip) {
+  const size_t buses_count = buses_.size();
   Bus& b = GetBus(name);
+  if (buses_.size() == buses_count) {
+    for (auto stop_id : b.stops) {
+      stops_[stop_id].buses.erase(b.id);
+    }
+    b.stops.clear();
+    changes_.buses_changed = true;
+  } else {
+    changes_.buses_added = true;
+  }
+  changes_.buses.insert(b.id);
+  changes_.removed_buses.erase(string(name));
+
   b.is_roundtrip = is_roundtrip;
   for (const auto& stop_name : stops) {
     Stop& s = GetStop(stop_name);
@@ -224,32 +478,41 @@ void Sprav::PImpl::AddBus(std::string_view name, const std::list<std::string> st
   }
 }
 
-void Sprav::PImpl::AddBus(std::string_view name, Bus&& bus) {
-  GetBus(name, std::move(bus));
+void Sprav::PImpl::RemoveStop(std::string_view name) {
+  if (!FindId(stop_index_, new_stop_ids_, name)) {
+    throw invalid_argument("Failed to remove stop " + string(name) + ": no such stop");
+  }
+  changes_.removed_stops.insert(string(name));
+}
+
+void Sprav::PImpl::RemoveBus(std::string_view name) {
+  if (!FindId(bus_index_, new_bus_ids_, name)) {
+    throw invalid_argument("Failed to remove bus " + string(name) + ": no such bus");
+  }
+  changes_.removed_buses.insert(string(name));
 }
 
-Stop& Sprav::PImpl::GetStop(string_view name, optional<Stop> pre_node) {
-  return GetNode<Stop>(stops_, stop_names_, name, pre_node);
+Stop& Sprav::PImpl::GetStop(string_view name) {
+  return GetNode(stops_, stop_names_, stop_index_, new_stop_ids_, name);
 }
 
-Bus& Sprav::PImpl::GetBus(string_view name, optional<Bus> pre_node) {
-  return GetNode<Bus>(buses_, bus_names_, name, pre_node);
+Bus& Sprav::PImpl::GetBus(string_view name) {
+  return GetNode(buses_, bus_names_, bus_index_, new_bus_ids_, name);
 }
 
 const Stop& Sprav::PImpl::GetStop(size_t id) const {
-  return stops_.at(stop_names_[id]);
+  return stops_[id];
 }
 
 const Bus& Sprav::PImpl::GetBus(size_t id) const {
-  return buses_.at(bus_names_[id]);
+  return buses_[id];
 }
 
 const Stop* Sprav::PImpl::FindStop(std::string_view name) const {
-  auto it = stops_.find(name);
-  if (it == stops_.end()) {
-    return nullptr;
+  if (auto id = stop_index_.Find(name); id) {
+    return &stops_[*id];
   }
-  return &it->second;
+  return nullptr;
 }
 
 Sprav::Router* Sprav::PImpl::GetRouter() const {
@@ -257,11 +520,10 @@ Sprav::Router* Sprav::PImpl::GetRouter() const {
 }
 
 const Bus* Sprav::PImpl::FindBus(std::string_view name) const {
-  auto it = buses_.find(name);
-  if (it == buses_.end()) {
-    return nullptr;
+  if (auto id = bus_index_.Find(name); id) {
+    return &buses_[*id];
   }
-  return &it->second;
+  return nullptr;
 }
 
 const Sprav::StopNames& Sprav::PImpl::GetStopNames() const {
@@ -277,8 +539,127 @@ Sprav::Route Sprav::PImpl::FindRoute(string_view from, string_view to) const {
     throw runtime_error("Failed to find route: no router");
   }
 
-  auto route = router_->BuildRoute(FindStop(from)->id * 2 + 1, FindStop(to)->id * 2 + 1);
-  return {*sprav_, std::move(route), Time()};
+  const Stop* from_stop = FindStop(from);
+  const Stop* to_stop = FindStop(to);
+  if (!from_stop || !to_stop) {
+    return {*sprav_, {}, Time()};
+  }
+
+  const RouteKey key{from_stop->id, to_stop->id, {}, 0};
+  if (auto cached = route_cache_.Get(key)) {
+    return std::move(*cached);
+  }
+
+  Route route{*sprav_, router_->BuildRoute(from_stop->id * 2 + 1, to_stop->id * 2 + 1), Time()};
+  route_cache_.Put(key, route);
+  return route;
+}
+
+vector<Sprav::Route> Sprav::PImpl::FindRouteAlternatives(string_view from, string_view to, size_t max_alternatives) const {
+  if (!router_) {
+    throw runtime_error("Failed to find route: no router");
+  }
+
+  vector<Route> result;
+  const Stop* from_stop = FindStop(from);
+  const Stop* to_stop = FindStop(to);
+  if (!from_stop || !to_stop || max_alternatives == 0) {
+    return result;
+  }
+  max_alternatives = min(max_alternatives, MAX_ROUTE_ALTERNATIVES);
+
+  const size_t from_vid = from_stop->id * 2 + 1;
+  const size_t to_vid = to_stop->id * 2 + 1;
+  const auto best = router_->BuildRoute(from_vid, to_vid);
+  if (!best) {
+    return result;
+  }
+  vector<size_t> best_edges(best->edge_count);
+  for (size_t idx = 0; idx < best->edge_count; ++idx) {
+    best_edges[idx] = router_->GetRouteEdgeId(best->id, idx);
+  }
+  router_->ReleaseRoute(best->id);
+
+  vector<Segments> accepted = {GetRouteSegments(best_edges)};
+  const auto segment_edges = GetSegmentEdges();
+  vector<double> penalties(router_graph_->GetEdgeCount(), 0);
+  auto penalize = [&](const Segments& segments) {
+    AddAlternativePenalties(segment_edges, segments, penalties);
+  };
+  penalize(accepted.front());
+
+  // One search object for all attempts: its state is stamped, not reset
+  Dijkstra dijkstra(*router_graph_);
+  const size_t max_attempts = max_alternatives * ALTERNATIVE_ATTEMPTS_PER_ROUTE;
+  for (size_t attempt = 0; attempt < max_attempts && result.size() < max_alternatives; ++attempt) {
+    dijkstra.RunTo(from_vid, to_vid, [&penalties](size_t edge_id, const Edge& edge) {
+      return edge.weight + penalties[edge_id];
+    });
+    if (!dijkstra.IsReached(to_vid)) {
+      break;
+    }
+
+    auto edges = dijkstra.GetPathEdges(to_vid);
+    double weight = 0;
+    for (auto edge_id : edges) {
+      weight += router_graph_->GetEdge(edge_id).weight;
+    }
+    auto segments = GetRouteSegments(edges);
+    if (segments.empty()) {
+      break;
+    }
+    penalize(segments);
+    if (weight > best->weight * ALTERNATIVE_MAX_STRETCH) {
+      continue;
+    }
+
+    const bool is_diverse = all_of(accepted.begin(), accepted.end(), [&segments](const Segments& other) {
+      const size_t shared = count_if(segments.begin(), segments.end(), [&other](size_t s) { return other.count(s) > 0; });
+      return shared <= ALTERNATIVE_MAX_SHARED * segments.size();
+    });
+    if (is_diverse) {
+      result.push_back({*sprav_, router_->AddRoute(weight, move(edges)), Time()});
+      accepted.push_back(move(segments));
+    }
+  }
+  return result;
+}
+
+Sprav::PImpl::Segments Sprav::PImpl::GetRouteSegments(const vector<size_t>& edges) const {
+  Segments segments;
+  for (auto edge_id : edges) {
+    const auto& stops = router_graph_->GetEdge(edge_id).extra.stops;
+    for (size_t idx = 1; idx < stops.size(); ++idx) {
+      segments.insert(stops[idx - 1] * stop_names_.size() + stops[idx]);
+    }
+  }
+  return segments;
+}
+
+Sprav::PImpl::SegmentEdges Sprav::PImpl::GetSegmentEdges() const {
+  SegmentEdges segment_edges;
+  for (size_t edge_id = 0; edge_id < router_graph_->GetEdgeCount(); ++edge_id) {
+    const auto& stops = router_graph_->GetEdge(edge_id).extra.stops;
+    for (size_t idx = 1; idx < stops.size(); ++idx) {
+      segment_edges[stops[idx - 1] * stop_names_.size() + stops[idx]].push_back(edge_id);
+    }
+  }
+  return segment_edges;
+}
+
+// Every use of a segment adds its share of the ride time to the edges
+// riding it; other edges keep their penalties
+void Sprav::PImpl::AddAlternativePenalties(const SegmentEdges& segment_edges, const Segments& segments, vector<double>& penalties) const {
+  for (auto segment : segments) {
+    auto it = segment_edges.find(segment);
+    if (it == segment_edges.end()) {
+      continue;
+    }
+    for (auto edge_id : it->second) {
+      const auto& edge = router_graph_->GetEdge(edge_id);
+      penalties[edge_id] += edge.weight * ALTERNATIVE_PENALTY / (edge.extra.stops.size() - 1);
+    }
+  }
 }
 
 Sprav::Route Sprav::PImpl::FindRouteToCompany(std::string_view from, const YellowPages::Query& query, const Time& time) const {
@@ -286,9 +667,19 @@ Sprav::Route Sprav::PImpl::FindRouteToCompany(std::string_view from, const Yello
     throw runtime_error("Failed to find route: no router");
   }
 
+  const Stop* from_stop = FindStop(from);
+  if (!from_stop) {
+    return {*sprav_, {}, time};
+  }
+
+  const RouteKey key{from_stop->id, NO_STOP, query.SerializeAsString(), time.day * 24 * 60 + time.min};
+  if (auto cached = route_cache_.Get(key)) {
+    return std::move(*cached);
+  }
+
   RouteInfoOpt winner;
   double winner_time = 0;
-  const size_t stop_vid = FindStop(from)->id * 2 + 1;
+  const size_t stop_vid = from_stop->id * 2 + 1;
   for (size_t id : pages_->Process(query)) {
     const size_t company_vid = stop_names_.size() * 2 + id;
     auto route_opt = router_->BuildRoute(stop_vid, company_vid);
@@ -310,10 +701,91 @@ Sprav::Route Sprav::PImpl::FindRouteToCompany(std::string_view from, const Yello
     }
   }
 
-  if (winner) {
-    return {*sprav_, std::move(winner.value()), time};
+  Route route{*sprav_, std::move(winner), time};
+  route_cache_.Put(key, route);
+  return route;
+}
+
+Sprav::RouteMatrix Sprav::PImpl::FindRouteMatrix(const vector<string>& from, const vector<string>& to, bool with_routes) const {
+  if (!router_) {
+    throw runtime_error("Failed to find route matrix: no router");
+  }
+
+  auto get_vertices = [this](const vector<string>& names) {
+    vector<optional<size_t>> vertices;
+    vertices.reserve(names.size());
+    for (const auto& name : names) {
+      const Stop* stop = FindStop(name);
+      vertices.push_back(stop ? optional<size_t>(stop->id * 2 + 1) : nullopt);
+    }
+    return vertices;
+  };
+  const auto sources = get_vertices(from);
+  const auto targets = get_vertices(to);
+
+  // Weights come straight from the all-pairs router, paths are only
+  // expanded when asked for
+  RouteMatrix matrix{from.size(), to.size(), {}, {}};
+  matrix.times.reserve(from.size() * to.size());
+  if (with_routes) {
+    matrix.routes.reserve(from.size() * to.size());
+  }
+  for (const auto& from_vertex : sources) {
+    for (const auto& to_vertex : targets) {
+      if (!from_vertex || !to_vertex) {
+        matrix.times.push_back(nullopt);
+        if (with_routes) {
+          matrix.routes.push_back({*sprav_, {}, Time()});
+        }
+        continue;
+      }
+
+      matrix.times.push_back(router_->GetRouteWeight(*from_vertex, *to_vertex));
+      if (with_routes) {
+        matrix.routes.push_back({*sprav_, router_->BuildRoute(*from_vertex, *to_vertex), Time()});
+      }
+    }
+  }
+  return matrix;
+}
+
+optional<Sprav::Reachable> Sprav::PImpl::FindReachable(std::string_view from, double max_time, const optional<YellowPages::Query>& query) const {
+  if (!router_graph_) {
+    throw runtime_error("Failed to find reachable: no graph");
+  }
+
+  const Stop* from_stop = FindStop(from);
+  if (!from_stop) {
+    return nullopt;
+  }
+
+  Pages::Companies companies;
+  if (query) {
+    companies = pages_->Process(*query);
   }
-  return {*sprav_, {}, time};
+
+  Dijkstra dijkstra(*router_graph_);
+  dijkstra.Run(from_stop->id * 2 + 1, max_time);
+
+  // Vertex layout: (stop) = 2 * id, (stop*) = 2 * id + 1, then companies
+  Reachable result;
+  const size_t stops_border = stop_names_.size() * 2;
+  for (auto vertex : dijkstra.GetReached()) {
+    const double time = dijkstra.GetWeight(vertex);
+    if (vertex >= stops_border) {
+      const size_t company_id = vertex - stops_border;
+      if (!query || companies.count(company_id) > 0) {
+        result.companies.emplace_back(company_id, time);
+      }
+    } else if (vertex % 2 == 1) {
+      result.stops.emplace_back(vertex / 2, time);
+    }
+  }
+  return result;
+}
+
+GeoIndex::Found Sprav::PImpl::FindNearestStops(GeoIndex::Point point, size_t count, optional<double> radius) const {
+  return stop_geo_index_.FindNearest(point, count, radius);
 }
 
 std::string Sprav::PImpl::GetMap() const {
@@ -324,22 +796,158 @@ std::string Sprav::PImpl::GetRouteMap(const Route& route) const {
   return GetMapper().RenderForRoute(route);
 }
 
+Json::Raw Sprav::PImpl::GetMapJson() const {
+  lock_guard g(map_json_m_);
+  if (!map_json_) {
+    TRACE("Sprav::GetMapJson render");
+    map_json_ = Json::MakeRaw(GetMap());
+  }
+  return *map_json_;
+}
+
+string Sprav::PImpl::GetRouteMapKey(const Route& route) {
+  ostringstream key;
+  for (const auto& item : route) {
+    key << static_cast<int>(item.type) << ' ' << item.name.size() << ' ' << item.name
+        << ' ' << item.company_id << ' ';
+    for (auto stop_id : route.GetStops(item)) {
+      key << stop_id << ',';
+    }
+    key << ';';
+  }
+  return key.str();
+}
+
+Json::Raw Sprav::PImpl::GetRouteMapJson(const Route& route) const {
+  const string key = GetRouteMapKey(route);
+  if (auto cached = route_map_cache_.Get(key)) {
+    return *cached;
+  }
+  TRACE("Sprav::GetRouteMapJson render");
+  auto map = Json::MakeRaw(GetRouteMap(route));
+  route_map_cache_.Put(key, map);
+  return map;
+}
+
 Pages::Companies Sprav::PImpl::FindCompanies(const YellowPages::Query& query) {
   return pages_->Process(query);
 }
 
+SuggestIndex::Found Sprav::PImpl::SuggestCompanies(string_view query, size_t count, size_t max_distance) const {
+  return pages_->Suggest(query, count, max_distance);
+}
+
+MemoryReport Sprav::PImpl::GetMemoryReport() const {
+  MemoryReport report;
+
+  size_t stops_size = Memory::GetHeapSize(stops_);
+  for (const auto& stop : stops_) {
+    stops_size += Memory::GetHeapSize(stop.buses) + Memory::GetHeapSize(stop.distances)
+        + Memory::GetHeapSize(stop.road_distances);
+  }
+  report.Add("stops", stops_.size(), stops_size);
+
+  size_t buses_size = Memory::GetHeapSize(buses_);
+  for (const auto& bus : buses_) {
+    buses_size += Memory::GetHeapSize(bus.stops);
+  }
+  report.Add("buses", buses_.size(), buses_size);
+
+  size_t names_size = Memory::GetHeapSize(stop_names_) + Memory::GetHeapSize(bus_names_)
+      + stop_index_.GetMemoryUsage() + bus_index_.GetMemoryUsage()
+      + Memory::GetHeapSize(new_stop_ids_) + Memory::GetHeapSize(new_bus_ids_);
+  for (const auto& names : {&stop_names_, &bus_names_}) {
+    for (const auto& name : *names) {
+      names_size += Memory::GetHeapSize(name);
+    }
+  }
+  report.Add("names", stop_names_.size() + bus_names_.size(), names_size);
+  report.Add("geo index", stop_geo_index_.Size(), stop_geo_index_.GetMemoryUsage());
+
+  if (router_graph_) {
+    size_t graph_size = sizeof(Graph) + router_graph_->GetMemoryUsage();
+    for (size_t edge_id = 0; edge_id < router_graph_->GetEdgeCount(); ++edge_id) {
+      graph_size += Memory::GetHeapSize(router_graph_->GetEdge(edge_id).extra.stops);
+    }
+    report.Add("graph", router_graph_->GetEdgeCount(), graph_size);
+  }
+
+  if (router_) {
+    const size_t vertex_count = router_graph_ ? router_graph_->GetVertexCount() : 0;
+    report.Add("router", vertex_count * vertex_count, sizeof(Router) + router_->GetMemoryUsage());
+  }
+
+  if (pages_) {
+    report.Add("pages", pages_->Size(), sizeof(Pages) + pages_->GetMemoryUsage());
+  }
+
+  if (mapper_) {
+    report.Add("mapper", mapper_->GetObjectsCount(), sizeof(SpravMapper) + mapper_->GetMemoryUsage());
+  }
+
+  const auto cache_stats = route_cache_.GetStats();
+  report.Add("route cache", cache_stats.count, cache_stats.size);
+  const auto map_cache_stats = route_map_cache_.GetStats();
+  report.Add("route map cache", map_cache_stats.count, map_cache_stats.size);
+
+  return report;
+}
+
+vector<Sprav::CacheStats> Sprav::PImpl::GetCacheStats() const {
+  const auto route_stats = route_cache_.GetStats();
+  const auto map_stats = route_map_cache_.GetStats();
+  return {
+    {"route cache", route_stats.hits, route_stats.misses, route_stats.evictions, route_stats.count, route_stats.size},
+    {"route map cache", map_stats.hits, map_stats.misses, map_stats.evictions, map_stats.count, map_stats.size},
+  };
+}
+
+void Sprav::PImpl::BuildNameIndex() {
+  TRACE("Sprav::BuildNameIndex");
+  stop_index_ = NameIndex({stop_names_.begin(), stop_names_.end()});
+  bus_index_ = NameIndex({bus_names_.begin(), bus_names_.end()});
+  new_stop_ids_ = {};
+  new_bus_ids_ = {};
+}
+
+void Sprav::PImpl::BuildGeoIndex() {
+  TRACE("Sprav::BuildGeoIndex");
+  vector<GeoIndex::Point> points;
+  points.reserve(stop_names_.size());
+  for (size_t id = 0; id < stop_names_.size(); ++id) {
+    const auto& stop = GetStop(id);
+    points.push_back({stop.lat, stop.lon});
+  }
+  stop_geo_index_ = GeoIndex(points);
+}
+
+void Sprav::PImpl::AddBusEdges(const Bus& bus) {
+  vector<Edge> edges;
+  CollectBusEdges(bus, edges);
+  for (auto& edge : edges) {
+    router_graph_->AddEdge(std::move(edge));
+  }
+}
+
+void Sprav::PImpl::CollectBusEdges(const Bus& bus, vector<Edge>& edges) const {
+  CollectBusStops(bus.id, bus.stops.begin(), bus.stops.end(), edges);
+  if (!bus.is_roundtrip) {
+    CollectBusStops(bus.id, bus.stops.rbegin(), bus.stops.rend(), edges);
+  }
+}
+
 template <typename InputIt>
-void Sprav::PImpl::AddBusStops(size_t bus_id, InputIt begin, InputIt end) {
+void Sprav::PImpl::CollectBusStops(size_t bus_id, InputIt begin, InputIt end, vector<Edge>& edges) const {
   for (auto it_from = begin; it_from != end; ++it_from) {
     double time = 0;
     size_t count = 0;
-    std::list<size_t> stops;
+    std::vector<size_t> stops;
     stops.push_back(*it_from);
     for (auto it_to = next(it_from); it_to != end; ++it_to) {
       time += GetStop(*prev(it_to)).DistanceTo(*it_to) / routing_settings_.bus_velocity;
       count += 1;
       stops.push_back(*it_to);
-      router_graph_->AddEdge({*it_from * 2, *it_to * 2 + 1, time, {RoutePartType::RIDE_BUS, bus_id, count, 0, stops}});
+      edges.push_back({*it_from * 2, *it_to * 2 + 1, time, {RoutePartType::RIDE_BUS, bus_id, count, 0, stops}});
     }
   }
 }
@@ -347,17 +955,20 @@ void Sprav::PImpl::AddBusStops(size_t bus_id, InputIt begin, InputIt end) {
 void Sprav::PImpl::AddCompany(size_t id, const YellowPages::Company& company) {
   const size_t vertex_id = stop_names_.size() * 2 + id;
   for (auto& s : company.nearby_stops()) {
-    auto& stop = GetStop(s.name());
+    const Stop* stop = FindStop(s.name());
+    if (!stop) {
+      continue;
+    }
     const double time = s.meters() / routing_settings_.pedestrian_velocity;
 
-    router_graph_->AddEdge({stop.id * 2 + 1, vertex_id, time,
-      {RoutePartType::WALK_TO_COMPANY, stop.id, 0, id, {}}}
+    router_graph_->AddEdge({stop->id * 2 + 1, vertex_id, time,
+      {RoutePartType::WALK_TO_COMPANY, stop->id, 0, id, {}}}
     );
   }
 }
 
 void Sprav::PImpl::BuildGraph() {
-  LOG_DURATION("Sprav::BuildGraph");
+  TRACE("Sprav::BuildGraph");
 
   const size_t stops_border = stop_names_.size() * 2;
   const size_t companies_border = stops_border + pages_->Size();
@@ -371,10 +982,27 @@ void Sprav::PImpl::BuildGraph() {
   }
 
   // Fill route point edges
-  for (const auto& [_, bus] : buses_) {
-    AddBusStops(bus.id, bus.stops.begin(), bus.stops.end());
-    if (!bus.is_roundtrip) {
-      AddBusStops(bus.id, bus.stops.rbegin(), bus.stops.rend());
+  // Every page of buses collects its edges into its own buffer; buffers
+  // are merged in bus id order, so edge ids match the sequential build.
+  {
+    TRACE("Sprav::BuildGraph bus edges");
+    vector<const Bus*> buses;
+    buses.reserve(buses_.size());
+    for (const auto& bus : buses_) {
+      buses.push_back(&bus);
+    }
+
+    auto futures = ProcessPages(buses, [this](auto page) {
+      vector<Edge> edges;
+      for (const Bus* bus : page) {
+        CollectBusEdges(*bus, edges);
+      }
+      return edges;
+    });
+    for (auto& f : futures) {
+      for (auto& edge : f.get()) {
+        router_graph_->AddEdge(std::move(edge));
+      }
     }
   }
 
@@ -384,15 +1012,54 @@ void Sprav::PImpl::BuildGraph() {
   }
 }
 
+void Sprav::PImpl::ExtendGraph(const unordered_set<size_t>& bus_ids) {
+  TRACE("Sprav::ExtendGraph");
+  if (!router_graph_ || !router_) {
+    throw runtime_error("Failed to extend graph: no graph or router");
+  }
+
+  const size_t first_new_edge = router_graph_->GetEdgeCount();
+  for (auto bus_id : set<size_t>(bus_ids.begin(), bus_ids.end())) {
+    AddBusEdges(GetBus(bus_id));
+  }
+  const size_t new_edges = router_graph_->GetEdgeCount() - first_new_edge;
+  if (new_edges > ROUTER_REBUILD_EDGES_PER_VERTEX * router_graph_->GetVertexCount()) {
+    BuildRouter();
+    return;
+  }
+  for (size_t edge_id = first_new_edge; edge_id < router_graph_->GetEdgeCount(); ++edge_id) {
+    router_->AddEdge(edge_id);
+  }
+}
+
 void Sprav::PImpl::BuildRouter() {
-  LOG_DURATION("Sprav::BuildRouter");
+  TRACE("Sprav::BuildRouter");
   if (!router_graph_) {
     throw runtime_error("Failed to build router: no graph");
   }
   router_ = make_shared<Router>(*router_graph_.get());
 }
 
-void Sprav::PImpl::CalcBusStats(Bus& b) const {
+void Sprav::PImpl::CalcBusStats(const vector<Bus*>& buses) const {
+  // Point ids are stop ids
+  Geo::Points points;
+  points.Reserve(stop_names_.size());
+  for (size_t id = 0; id < stop_names_.size(); ++id) {
+    const Stop& stop = GetStop(id);
+    points.Add(stop.lat, stop.lon);
+  }
+
+  auto futures = ProcessPages(buses, [this, &points](auto page) {
+    for (Bus* bus : page) {
+      CalcBusStats(*bus, points);
+    }
+  });
+  for (auto& f : futures) {
+    f.get();
+  }
+}
+
+void Sprav::PImpl::CalcBusStats(Bus& b, const Geo::Points& points) const {
   b.stops_count = b.is_roundtrip ? b.stops.size() : b.stops.size() * 2 - 1;
   b.unique_stops_count = unordered_set<size_t>(b.stops.begin(), b.stops.end()).size();
 
@@ -401,11 +1068,14 @@ void Sprav::PImpl::CalcBusStats(Bus& b) const {
   b.curvature = 1;
 
   if (b.stops.size() > 1) {
+    Geo::IndexPairs segments;
+    segments.reserve(b.stops.size() - 1);
     for (auto it = ++b.stops.begin(); it != b.stops.end(); ++it) {
-      const Stop& from = GetStop(*prev(it));
-      const Stop& to = GetStop(*it);
-      b.length += from.DistanceTo(to.id);
-      curve_length += GetDistance(from, to);
+      b.length += GetStop(*prev(it)).DistanceTo(*it);
+      segments.emplace_back(*prev(it), *it);
+    }
+    for (double distance : points.GetDistances(segments)) {
+      curve_length += distance;
     }
     if (!b.is_roundtrip) {
       curve_length *= 2;
@@ -418,6 +1088,80 @@ void Sprav::PImpl::CalcBusStats(Bus& b) const {
   }
 }
 
+future<shared_ptr<SpravMapper>> Sprav::PImpl::BuildMapperAsync() const {
+  return async(launch::async, [this] {
+    TRACE("Sprav::BuildMapper");
+    return make_shared<SpravMapper>(sprav_);
+  });
+}
+
 SpravMapper& Sprav::PImpl::GetMapper() const {
   return *mapper_;
+}
+
+void Sprav::PImpl::Compact() {
+  TRACE("Sprav::Compact");
+
+  struct StopData {
+    string name;
+    double lat;
+    double lon;
+    unordered_map<string, int> distances;
+  };
+
+  struct BusData {
+    string name;
+    list<string> stops;
+    bool is_roundtrip;
+  };
+
+  for (const auto& name : changes_.removed_stops) {
+    for (auto bus_id : stops_[*FindId(stop_index_, new_stop_ids_, name)].buses) {
+      if (changes_.removed_buses.count(bus_names_[bus_id]) == 0) {
+        throw runtime_error("Failed to remove stop " + name + ": it is used by bus " + bus_names_[bus_id]);
+      }
+    }
+  }
+
+  vector<StopData> stops;
+  for (const auto& s : stops_) {
+    if (changes_.removed_stops.count(stop_names_[s.id]) > 0) {
+      continue;
+    }
+    StopData data{stop_names_[s.id], s.lat, s.lon, {}};
+    for (auto [other, distance] : s.road_distances) {
+      if (changes_.removed_stops.count(stop_names_[other]) == 0) {
+        data.distances[stop_names_[other]] = distance;
+      }
+    }
+    stops.push_back(move(data));
+  }
+
+  vector<BusData> buses;
+  for (const auto& b : buses_) {
+    if (changes_.removed_buses.count(bus_names_[b.id]) > 0) {
+      continue;
+    }
+    BusData data{bus_names_[b.id], {}, b.is_roundtrip};
+    for (auto stop_id : b.stops) {
+      data.stops.push_back(stop_names_[stop_id]);
+    }
+    buses.push_back(move(data));
+  }
+
+  stops_.clear();
+  stop_names_.clear();
+  buses_.clear();
+  bus_names_.clear();
+  stop_index_ = {};
+  bus_index_ = {};
+  new_stop_ids_ = {};
+  new_bus_ids_ = {};
+
+  for (const auto& s : stops) {
+    AddStop(s.name, s.lat, s.lon, s.distances);
+  }
+  for (const auto& b : buses) {
+    AddBus(b.name, b.stops, b.is_roundtrip);
+  }
 }
\ No newline at end of file
@@ -1,13 +1,26 @@
 #pragma once
 
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "geo_distance.h"
+#include "lru_cache.h"
+#include "name_index.h"
 #include "sprav.h"
 #include "sprav_mapper.h"
 #include "working_time.h"
 
 class Sprav::PImpl {
  private:
-  using Stops = std::unordered_map<std::string_view, Stop>;
-  using Buses = std::unordered_map<std::string_view, Bus>;
+  // Stops and buses are stored by id; names are resolved by the perfect
+  // hash indices, plus a map of names added since they were last built
+  using Stops = std::vector<Stop>;
+  using Buses = std::vector<Bus>;
+  using NewIds = std::unordered_map<std::string_view, size_t>;
 
  public:
   PImpl(Sprav* sprav);
@@ -26,15 +39,13 @@ class Sprav::PImpl {
   PagesPtr GetPages() const;
 
   void BuildBase();
+  void UpdateBase();
 
   void AddStop(std::string_view name, double lat, double lon, const std::unordered_map<std::string, int>& distances);
-  void AddStop(std::string_view name, Stop&& stop);
-
   void AddBus(std::string_view name, const std::list<std::string> stops, bool is_roundtrip);
-  void AddBus(std::string_view name, Bus&& bus);
 
-  Stop& GetStop(std::string_view name, std::optional<Stop> pre_node = {});
-  Bus& GetBus(std::string_view name, std::optional<Bus> pre_node = {});
+  void RemoveStop(std::string_view name);
+  void RemoveBus(std::string_view name);
 
   const Stop& GetStop(size_t id) const;
   const Bus& GetBus(size_t id) const;
@@ -47,19 +58,35 @@ class Sprav::PImpl {
 
   Router* GetRouter() const;
   Route FindRoute(std::string_view from, std::string_view to) const;
+  std::vector<Route> FindRouteAlternatives(std::string_view from, std::string_view to, size_t max_alternatives) const;
   Route FindRouteToCompany(std::string_view from, const YellowPages::Query& query, const Time& time) const;
+  RouteMatrix FindRouteMatrix(const std::vector<std::string>& from, const std::vector<std::string>& to, bool with_routes) const;
+  std::optional<Reachable> FindReachable(std::string_view from, double max_time, const std::optional<YellowPages::Query>& query) const;
+  GeoIndex::Found FindNearestStops(GeoIndex::Point point, size_t count, std::optional<double> radius) const;
 
   std::string GetMap() const;
   std::string GetRouteMap(const Route& route) const;
+  Json::Raw GetMapJson() const;
+  Json::Raw GetRouteMapJson(const Route& route) const;
 
   Pages::Companies FindCompanies(const YellowPages::Query& query);
+  SuggestIndex::Found SuggestCompanies(std::string_view query, size_t count, size_t max_distance) const;
+
+  MemoryReport GetMemoryReport() const;
+  std::vector<CacheStats> GetCacheStats() const;
 
  private:
   Sprav* sprav_;
   StopNames stop_names_;
   Stops stops_;
   BusNames bus_names_;
-  mutable Buses buses_;
+  Buses buses_;
+
+  NameIndex stop_index_;
+  NameIndex bus_index_;
+  NewIds new_stop_ids_;
+  NewIds new_bus_ids_;
+  GeoIndex stop_geo_index_;
 
   SerializationSettings serialization_settings_;
   RoutingSettings routing_settings_;
@@ -72,14 +99,80 @@ class Sprav::PImpl {
 
   PagesPtr pages_;
 
+  // Route: (from, to) stop ids; RouteToCompany: from stop id,
+  // serialized query and request time in minutes since week start
+  struct RouteKey {
+    size_t from;
+    size_t to;
+    std::string query;
+    double time;
+
+    bool operator==(const RouteKey& other) const;
+  };
+  struct RouteKeyHasher {
+    size_t operator()(const RouteKey& key) const;
+  };
+  using RouteCache = LruCache<RouteKey, Route, RouteKeyHasher>;
+  mutable RouteCache route_cache_;
+
+  static size_t GetRouteCacheEntrySize(const RouteKey& key, const Route& route);
+
+  // Maps printed as JSON strings. Route maps are keyed by the type, bus or
+  // stop name, company id and bus stops of every route item, which is all
+  // that their rendering depends on; printed items omit the stops.
+  mutable std::mutex map_json_m_;
+  mutable std::optional<Json::Raw> map_json_;
+  using RouteMapCache = LruCache<std::string, Json::Raw>;
+  mutable RouteMapCache route_map_cache_;
+
+  static std::string GetRouteMapKey(const Route& route);
+  static size_t GetRouteMapCacheEntrySize(const std::string& key, const Json::Raw& map);
+
+  void ClearCaches();
+
+  // Consecutive stop pairs ridden along the edges, as from * stops + to
+  using Segments = std::unordered_set<size_t>;
+  Segments GetRouteSegments(const std::vector<size_t>& edges) const;
+  // Ids of the edges riding every segment, once per ridden segment
+  using SegmentEdges = std::unordered_map<size_t, std::vector<size_t>>;
+  SegmentEdges GetSegmentEdges() const;
+  void AddAlternativePenalties(const SegmentEdges& segment_edges, const Segments& segments, std::vector<double>& penalties) const;
+
+  struct Changes {
+    std::unordered_set<size_t> stops;
+    std::unordered_set<size_t> buses;
+    std::unordered_set<std::string> removed_stops;
+    std::unordered_set<std::string> removed_buses;
+    bool stops_added = false;
+    bool buses_added = false;
+    bool buses_changed = false;
+    bool distances_changed = false;
+  };
+  Changes changes_;
+
+  // Find or add by name, only while make_base or update_base is building
+  Stop& GetStop(std::string_view name);
+  Bus& GetBus(std::string_view name);
+
+  void BuildNameIndex();
+  void BuildGeoIndex();
+
   template <typename InputIt>
-  void AddBusStops(size_t bus_id, InputIt begin, InputIt end);
+  void CollectBusStops(size_t bus_id, InputIt begin, InputIt end, std::vector<Edge>& edges) const;
+  void CollectBusEdges(const Bus& bus, std::vector<Edge>& edges) const;
+  void AddBusEdges(const Bus& bus);
   void AddCompany(size_t id, const YellowPages::Company& company);
   void BuildGraph();
+  void ExtendGraph(const std::unordered_set<size_t>& bus_ids);
 
   void BuildRouter();
 
-  void CalcBusStats(Bus& r) const;
+  void CalcBusStats(const std::vector<Bus*>& buses) const;
+  void CalcBusStats(Bus& r, const Geo::Points& points) const;
+
+  bool UpdateDistance(Stop& from, const Stop& to);
+  void Compact();
 
+  std::future<std::shared_ptr<SpravMapper>> BuildMapperAsync() const;
   SpravMapper& GetMapper() const;
 };
\ No newline at end of file
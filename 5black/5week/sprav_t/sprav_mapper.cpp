@@ -4,6 +4,7 @@
 #include <algorithm>
 
 #include "map_builder.h"
+#include "memory_report.h"
 #include "point_projector.h"
 
 using namespace std;
@@ -11,7 +12,7 @@ using namespace std;
 namespace {
 
 Builder GetMainMapBuilder(const SpravMapper& mapper, optional<Svg::Document>& doc_cache) {
-  LOG_DURATION("GetMainMapBuilder");
+  TRACE("GetMainMapBuilder");
 
   if (doc_cache) {
     return Builder(mapper, doc_cache);
@@ -80,6 +81,21 @@ const PointProjector& SpravMapper::GetProjector() const {
   return *projector_;
 }
 
+size_t SpravMapper::GetObjectsCount() const {
+  return main_map_ ? main_map_->GetObjectsCount() : 0;
+}
+
+size_t SpravMapper::GetMemoryUsage() const {
+  size_t size = Memory::GetHeapSize(sorted_stop_names_) + Memory::GetHeapSize(sorted_bus_names_);
+  if (projector_) {
+    size += sizeof(PointProjector) + projector_->GetMemoryUsage();
+  }
+  if (main_map_) {
+    size += main_map_->GetMemoryUsage();
+  }
+  return size;
+}
+
 std::string SpravMapper::Render() {
   return GetMainMapBuilder(*this, main_map_).Render();
 }
@@ -32,6 +32,10 @@ class SpravMapper {
   const Sprav* GetSprav() const;
   const PointProjector& GetProjector() const;
 
+  // Objects of the rendered main map, zero until the first render
+  size_t GetObjectsCount() const;
+  size_t GetMemoryUsage() const;
+
   std::string Render();
   std::string RenderForRoute(const Sprav::Route& route);
 
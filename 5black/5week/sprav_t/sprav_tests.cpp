@@ -1,5 +1,19 @@
 #include "sprav_tests.h"
 
+#include "dijkstra.h"
+#include "geo_distance.h"
+#include "geo_index.h"
+#include "lru_cache.h"
+#include "memory_report.h"
+#include "name_index.h"
+#include "router.h"
+#include "stop.h"
+#include "suggest_index.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cmath>
+
 using namespace std;
 
 namespace SpravTests {
@@ -8,8 +22,331 @@ void Test() {
 
 }
 
+void TestNameIndex() {
+  const vector<string> names = {"Tolstopaltsevo", "Marushkino", "Rasskazovka", "Biryulyovo Zapadnoye", "", "Universam"};
+  const vector<string_view> views(names.begin(), names.end());
+
+  NameIndex index(views);
+  ASSERT_EQUAL(index.Size(), names.size());
+  for (size_t id = 0; id < names.size(); ++id) {
+    ASSERT_EQUAL(index.Find(names[id]).value_or(names.size()), id);
+    ASSERT_EQUAL(index.GetName(id), names[id]);
+  }
+  ASSERT(!index.Find("Biryusinka"));
+  ASSERT(!index.Find("Marushkino "));
+
+  SpravSerialize::NameIndex m;
+  index.Serialize(m);
+  NameIndex parsed(m);
+  for (size_t id = 0; id < names.size(); ++id) {
+    ASSERT_EQUAL(parsed.Find(names[id]).value_or(names.size()), id);
+  }
+  ASSERT(!parsed.Find("Biryusinka"));
+
+  ASSERT(!NameIndex().Find("Marushkino"));
+}
+
+void TestDijkstra() {
+  Graph::DirectedWeightedGraph<double, int> graph(5);
+  graph.AddEdge({0, 1, 1, 0});
+  graph.AddEdge({1, 2, 2, 0});
+  graph.AddEdge({0, 2, 5, 0});
+  graph.AddEdge({2, 3, 4, 0});
+  graph.AddEdge({4, 0, 1, 0});
+
+  Graph::Dijkstra<double, int> dijkstra(graph);
+  dijkstra.Run(0);
+  ASSERT_EQUAL(dijkstra.GetReached(), vector<size_t>({0, 1, 2, 3}));
+  ASSERT_EQUAL(dijkstra.GetWeight(2), 3.0);
+  ASSERT_EQUAL(dijkstra.GetWeight(3), 7.0);
+  ASSERT_EQUAL(dijkstra.GetPathEdges(3), vector<size_t>({0, 1, 3}));
+  ASSERT(!dijkstra.IsReached(4));
+
+  dijkstra.Run(0, 3.0);
+  ASSERT_EQUAL(dijkstra.GetReached(), vector<size_t>({0, 1, 2}));
+  ASSERT(!dijkstra.IsReached(3));
+
+  dijkstra.Run(4);
+  ASSERT_EQUAL(dijkstra.GetWeight(3), 8.0);
+  ASSERT(dijkstra.GetPathEdges(4).empty());
+
+  // Penalizing the 0 -> 1 edge makes the direct one shorter
+  dijkstra.RunTo(0, 2, [](size_t edge_id, const auto& edge) {
+    return edge.weight + (edge_id == 0 ? 10 : 0);
+  });
+  ASSERT_EQUAL(dijkstra.GetPathEdges(2), vector<size_t>({2}));
+  ASSERT_EQUAL(dijkstra.GetWeight(2), 5.0);
+  ASSERT(!dijkstra.IsReached(3));
+}
+
+void CheckRouterSerialization(const Graph::DirectedWeightedGraph<double, int>& graph) {
+  Graph::Router<double, int> router(graph);
+  SpravSerialize::Router m;
+  router.Serialize(m);
+  Graph::Router<double, int> parsed(graph, m);
+
+  for (size_t from = 0; from < graph.GetVertexCount(); ++from) {
+    for (size_t to = 0; to < graph.GetVertexCount(); ++to) {
+      const auto route = router.BuildRoute(from, to);
+      const auto parsed_route = parsed.BuildRoute(from, to);
+      ASSERT_EQUAL(route.has_value(), parsed_route.has_value());
+      if (!route) {
+        continue;
+      }
+      ASSERT_EQUAL(route->weight, parsed_route->weight);
+      ASSERT_EQUAL(route->edge_count, parsed_route->edge_count);
+      for (size_t idx = 0; idx < route->edge_count; ++idx) {
+        ASSERT_EQUAL(router.GetRouteEdgeId(route->id, idx), parsed.GetRouteEdgeId(parsed_route->id, idx));
+      }
+    }
+  }
+}
+
+void TestRouterSerialization() {
+  Graph::DirectedWeightedGraph<double, int> graph(20);
+  for (size_t vertex = 0; vertex + 1 < 20; ++vertex) {
+    graph.AddEdge({vertex, vertex + 1, 1.5, 0});
+  }
+  graph.AddEdge({0, 10, 3, 0});
+  graph.AddEdge({19, 5, 0.25, 0});
+  CheckRouterSerialization(graph);
+
+  // Vertex 0 is entered by 300 edges, so its ranks take 9 bits and cross
+  // bytes. Nothing leaves vertex 301, so its row is stored empty.
+  const size_t vertex_count = 302;
+  Graph::DirectedWeightedGraph<double, int> hub(vertex_count);
+  for (size_t vertex = 1; vertex <= 300; ++vertex) {
+    hub.AddEdge({vertex - 1, vertex, 0.5, 0});
+    hub.AddEdge({vertex, 0, static_cast<double>(vertex % 7), 0});
+  }
+  hub.AddEdge({300, 301, 1, 0});
+  CheckRouterSerialization(hub);
+
+  Graph::Router<double, int> router(hub);
+  SpravSerialize::Router m;
+  router.Serialize(m);
+  ASSERT_EQUAL(m.row_size(), static_cast<int>(vertex_count));
+  ASSERT(m.row(vertex_count - 1).empty());
+}
+
+void TestRouteWeights() {
+  // Two components, one-way edges and an isolated vertex: some pairs are
+  // unreachable either way, some only one way
+  const size_t vertex_count = 9;
+  Graph::DirectedWeightedGraph<double, int> graph(vertex_count);
+  graph.AddEdge({0, 1, 2, 0});
+  graph.AddEdge({1, 2, 1.5, 0});
+  graph.AddEdge({2, 0, 4, 0});
+  graph.AddEdge({0, 2, 5, 0});
+  graph.AddEdge({2, 3, 0.5, 0});
+  graph.AddEdge({5, 6, 1, 0});
+  graph.AddEdge({6, 7, 1, 0});
+  graph.AddEdge({7, 5, 1, 0});
+  graph.AddEdge({6, 4, 3, 0});
+
+  Graph::Router<double, int> router(graph);
+  for (size_t from = 0; from < vertex_count; ++from) {
+    for (size_t to = 0; to < vertex_count; ++to) {
+      const auto weight = router.GetRouteWeight(from, to);
+      const auto route = router.BuildRoute(from, to);
+      ASSERT_EQUAL(weight.has_value(), route.has_value());
+      if (!route) {
+        continue;
+      }
+      ASSERT_EQUAL(*weight, route->weight);
+
+      double edges_weight = 0;
+      for (size_t idx = 0; idx < route->edge_count; ++idx) {
+        edges_weight += router.GetRouteEdge(route->id, idx).weight;
+      }
+      ASSERT_EQUAL(edges_weight, route->weight);
+      router.ReleaseRoute(route->id);
+    }
+  }
+
+  ASSERT_EQUAL(*router.GetRouteWeight(0, 3), 4.0);
+  ASSERT_EQUAL(*router.GetRouteWeight(5, 4), 4.0);
+  ASSERT(!router.GetRouteWeight(3, 0));
+  ASSERT(!router.GetRouteWeight(0, 5));
+  ASSERT(!router.GetRouteWeight(4, 6));
+  ASSERT(!router.GetRouteWeight(8, 0));
+  ASSERT(!router.GetRouteWeight(0, 8));
+}
+
+void TestGeoDistance() {
+  const vector<pair<double, double>> coords = {{55.611087, 37.20829}, {55.595884, 37.209755}, {55.632761, 37.333324}, {55.574371, 37.6517}};
+  Geo::Points points;
+  vector<Stop> stops;
+  for (auto [lat, lon] : coords) {
+    points.Add(lat, lon);
+    Stop stop{};
+    stop.lat = lat;
+    stop.lon = lon;
+    stops.push_back(stop);
+  }
+
+  const Geo::IndexPairs pairs = {{0, 1}, {1, 2}, {2, 3}, {3, 0}};
+  const auto exact = points.GetDistances(pairs);
+  const auto approx = points.GetApproxDistances(pairs);
+  for (size_t i = 0; i < pairs.size(); ++i) {
+    const double expected = GetDistance(stops[pairs[i].first], stops[pairs[i].second]);
+    ASSERT_EQUAL(exact[i], expected);
+    ASSERT(abs(approx[i] - expected) <= 1e-6 * expected + 1e-3);
+  }
+}
+
+void TestGeoIndex() {
+  vector<GeoIndex::Point> points;
+  for (int i = 0; i < 40; ++i) {
+    for (int j = 0; j < 40; ++j) {
+      points.push_back({55.5 + i * 0.01, 37.5 + j * 0.01});
+    }
+  }
+  GeoIndex index(points);
+
+  SpravSerialize::GeoIndex m;
+  index.Serialize(m);
+  GeoIndex parsed(m);
+
+  const GeoIndex::Point query{55.6512, 37.6033};
+  vector<pair<double, size_t>> expected;
+  for (size_t id = 0; id < points.size(); ++id) {
+    Stop lhs{}, rhs{};
+    lhs.lat = query.lat;
+    lhs.lon = query.lon;
+    rhs.lat = points[id].lat;
+    rhs.lon = points[id].lon;
+    expected.emplace_back(GetDistance(lhs, rhs), id);
+  }
+  sort(expected.begin(), expected.end());
+
+  for (const auto* idx : {&index, &parsed}) {
+    const auto found = idx->FindNearest(query, 5);
+    ASSERT_EQUAL(found.size(), 5u);
+    for (size_t i = 0; i < found.size(); ++i) {
+      ASSERT_EQUAL(found[i].first, expected[i].second);
+      ASSERT(abs(found[i].second - expected[i].first) < 1);
+    }
+  }
+
+  const auto within = index.FindNearest(query, 100, 1000);
+  const size_t within_count = count_if(expected.begin(), expected.end(), [](const auto& e) { return e.first <= 1000; });
+  ASSERT_EQUAL(within.size(), within_count);
+  ASSERT(index.FindNearest(query, 0).empty());
+  ASSERT(GeoIndex().FindNearest(query, 3).empty());
+}
+
+void TestLruCache() {
+  LruCache<int, string> cache(10, [](int, const string& value) { return value.size(); });
+
+  cache.Put(1, "aaaa");
+  cache.Put(2, "bbbb");
+  ASSERT_EQUAL(cache.Get(1).value_or(""), "aaaa");
+  ASSERT(!cache.Get(3).has_value());
+
+  cache.Put(3, "cccc");
+  ASSERT(!cache.Get(2).has_value());
+  ASSERT(cache.Get(1).has_value());
+  ASSERT(cache.Get(3).has_value());
+
+  cache.Put(4, "too long value");
+  ASSERT(!cache.Get(4).has_value());
+
+  const auto stats = cache.GetStats();
+  ASSERT_EQUAL(stats.hits, 3u);
+  ASSERT_EQUAL(stats.misses, 3u);
+  ASSERT_EQUAL(stats.evictions, 1u);
+  ASSERT_EQUAL(stats.count, 2u);
+  ASSERT_EQUAL(stats.size, 8u);
+
+  cache.Clear();
+  ASSERT(!cache.Get(1).has_value());
+  ASSERT_EQUAL(cache.GetStats().size, 0u);
+}
+
+void TestTrace() {
+#ifdef SPRAV_TRACE
+  {
+    TRACE("TestTrace outer");
+    TRACE("TestTrace inner");
+  }
+
+  vector<Trace::Span> spans = Trace::GetSpans();
+  auto find_span = [&spans](string_view name) {
+    return *find_if(spans.begin(), spans.end(), [name](const auto& span) { return span.name == name; });
+  };
+  const auto outer = find_span("TestTrace outer");
+  const auto inner = find_span("TestTrace inner");
+  ASSERT_EQUAL(inner.parent_id, outer.id);
+  ASSERT_EQUAL(inner.thread_id, outer.thread_id);
+  ASSERT(outer.start_ns <= inner.start_ns);
+  ASSERT(inner.start_ns + inner.duration_ns <= outer.start_ns + outer.duration_ns);
+#endif
+}
+
+void TestSuggestIndex() {
+  const vector<string> names = {"Ромашка", "Ромашковый сад", "Роза", "Пятёрочка", "Pyaterochka", "Аптека"};
+  vector<SuggestIndex::Entry> entries;
+  for (size_t id = 0; id < names.size(); ++id) {
+    entries.push_back({names[id], static_cast<uint32_t>(id)});
+  }
+  // Company 1 ranks above company 0, 4 goes under the synonym of 3
+  entries.push_back({"Пятерочка", 4});
+  const SuggestIndex index(entries, {1, 2, 0, 0, 0, 0});
+
+  ASSERT_EQUAL(index.Suggest("ром", 5, 0), (SuggestIndex::Found{{1, 0}, {0, 0}}));
+  ASSERT_EQUAL(index.Suggest("РОМАШКА", 5, 0), (SuggestIndex::Found{{0, 0}}));
+  ASSERT_EQUAL(index.Suggest("ро", 1, 0), (SuggestIndex::Found{{1, 0}}));
+  ASSERT(index.Suggest("рог", 5, 0).empty());
+  // ё is searched as е
+  ASSERT_EQUAL(index.Suggest("пятер", 5, 0), (SuggestIndex::Found{{3, 0}, {4, 0}}));
+
+  // Exact prefixes come before the ones with typos
+  ASSERT_EQUAL(index.Suggest("рза", 5, 1), (SuggestIndex::Found{{2, 1}}));
+  ASSERT_EQUAL(index.Suggest("аптеко", 5, 1), (SuggestIndex::Found{{5, 1}}));
+  ASSERT_EQUAL(index.Suggest("ромаш", 5, 2), (SuggestIndex::Found{{1, 0}, {0, 0}, {2, 2}}));
+  ASSERT(index.Suggest("аптеко", 5, 0).empty());
+
+  ASSERT_EQUAL(SuggestIndex::GetDefaultDistance("ро"), 0u);
+  ASSERT_EQUAL(SuggestIndex::GetDefaultDistance("рома"), 1u);
+  ASSERT_EQUAL(SuggestIndex::GetDefaultDistance("ромашка"), 2u);
+
+  SpravSerialize::SuggestIndex m;
+  index.Serialize(m);
+  const SuggestIndex parsed(m);
+  ASSERT_EQUAL(parsed.Size(), index.Size());
+  ASSERT_EQUAL(parsed.Suggest("ромаш", 5, 2), index.Suggest("ромаш", 5, 2));
+}
+
+void TestMemoryReport() {
+  vector<int> v;
+  v.reserve(10);
+  ASSERT_EQUAL(Memory::GetHeapSize(v), 10 * sizeof(int));
+  ASSERT_EQUAL(Memory::GetHeapSize(string("short")), 0u);
+  ASSERT(Memory::GetHeapSize(string(100, 'a')) > 100);
+
+  NameIndex index({"Marushkino", "Rasskazovka"});
+  ASSERT(index.GetMemoryUsage() >= string_view("MarushkinoRasskazovka").size());
+
+  MemoryReport report;
+  report.Add("stops", 2, 100);
+  report.Add("buses", 1, 50);
+  ASSERT_EQUAL(report.GetItems().size(), 2u);
+  ASSERT_EQUAL(report.GetTotalBytes(), 150u);
+}
+
 }
 
 void TestSprav(TestRunner& tr) {
   RUN_TEST(tr, SpravTests::Test);
-}
\ No newline at end of file
+  RUN_TEST(tr, SpravTests::TestNameIndex);
+  RUN_TEST(tr, SpravTests::TestDijkstra);
+  RUN_TEST(tr, SpravTests::TestRouterSerialization);
+  RUN_TEST(tr, SpravTests::TestRouteWeights);
+  RUN_TEST(tr, SpravTests::TestGeoDistance);
+  RUN_TEST(tr, SpravTests::TestGeoIndex);
+  RUN_TEST(tr, SpravTests::TestSuggestIndex);
+  RUN_TEST(tr, SpravTests::TestLruCache);
+  RUN_TEST(tr, SpravTests::TestTrace);
+  RUN_TEST(tr, SpravTests::TestMemoryReport);
+}
@@ -1,15 +1,33 @@
 #include "spravio.h"
 
-#include <queue>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iostream>
 
+#include "blocking_queue.h"
 #include "json.h"
-#include "profile.h"
+#include "trace.h"
 #include "reader.h"
+#include "request_stats.h"
 #include "string_view_utils.h"
 
 using namespace std;
 using namespace std::placeholders;
 
+namespace {
+
+// Parsed requests waiting for the executor: bounds the memory taken
+// when parsing runs ahead of processing
+const size_t PENDING_REQUESTS_CAPACITY = 4096;
+
+uint64_t ElapsedNs(chrono::steady_clock::time_point start) {
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
 class SpravIO::PImpl {
  public:
   PImpl(SpravPtr sprav, Mode mode, std::ostream& output, Format format)
@@ -19,9 +37,15 @@ class SpravIO::PImpl {
       , output_format_(format) {}
 
   void Process(std::istream& input) {
-    LOG_DURATION("Process");
+    TRACE("Process");
+    if (mode_ == Mode::PROCESS_REQUESTS) {
+      TRACE("Process: ProcessRequests");
+      ProcessRequests(input);
+      return;
+    }
+
     auto doc = make_unique<Json::Document>([&input]() mutable {
-      LOG_DURATION("Process: loading json");
+      TRACE("Process: loading json");
       return Json::Load(input);
     }());
     auto& dict = doc->GetRoot().AsDict();
@@ -29,41 +53,31 @@ class SpravIO::PImpl {
     ReadSerializationSettings(dict);
 
     if (mode_ == Mode::MAKE_BASE) {
-      LOG_DURATION("Process: MakeBase");
+      TRACE("Process: MakeBase");
       MakeBase(dict);
-    } else if (mode_ == Mode::PROCESS_REQUESTS) {
-      LOG_DURATION("Process: ProcessRequests");
-      ProcessRequests(dict);
+    } else if (mode_ == Mode::UPDATE_BASE) {
+      TRACE("Process: UpdateBase");
+      UpdateBase(dict);
     }
 
     {
-      LOG_DURATION("Process: destruct json");
+      TRACE("Process: destruct json");
       doc.reset();
     }
   }
 
-  void Output(queue<ResponsePtr> responses) {
-    SumMeter resp_destr("Response desruction");
-    SumMeter resp_output("Response output");
-
+  void OutputResponse(const Request& request, const Response& response, uint64_t process_ns,
+                      bool first, RequestStats& stats) {
     switch (output_format_) {
       case Format::JSON:
       case Format::JSON_PRETTY:
       {
-        os_ << "[";
-        bool first = true;
-        while (!responses.empty()) {
-          {
-            METER_DURATION(resp_output);
-            os_ << (first ? first = false, "" : ",");
-            Json::PrintNode(responses.front()->AsJson(), os_);
-          }
-          {
-            METER_DURATION(resp_destr);
-            responses.pop();
-          }
-        }
-        os_ << "]\n";
+        TRACE("Response output");
+        os_ << (first ? "" : ",");
+        const auto start = chrono::steady_clock::now();
+        const auto node = response.AsJson();
+        stats.Add(request.GetType(), request.GetId(), process_ns, ElapsedNs(start));
+        Json::PrintNode(node, os_);
         break;
       }
 
@@ -72,6 +86,19 @@ class SpravIO::PImpl {
     }
   }
 
+  void PrintMemoryReport(const char* stage) const {
+    cerr << "Memory after " << stage << ":\n";
+    sprav_->GetMemoryReport().Print(cerr);
+  }
+
+  void PrintCacheStats() const {
+    cerr << "cache,hits,misses,evictions,count,bytes\n";
+    for (const auto& cache : sprav_->GetCacheStats()) {
+      cerr << cache.name << "," << cache.hits << "," << cache.misses << "," << cache.evictions
+           << "," << cache.count << "," << cache.bytes << "\n";
+    }
+  }
+
   void ReadSerializationSettings(const Json::Dict& root) {
     if (auto it = root.find("serialization_settings"); it != root.end()) {
       sprav_->SetSerializationSettings({it->second.AsDict()});
@@ -107,29 +134,133 @@ class SpravIO::PImpl {
 
     sprav_->BuildBase();
     sprav_->Serialize();
+    PrintMemoryReport("make_base");
   }
 
-  void ProcessRequests(const Json::Dict& root) {
+  void UpdateBase(const Json::Dict& root) {
     {
-      LOG_DURATION("ProcessRequests: Deserialization");
+      TRACE("UpdateBase: Deserialization");
       sprav_->Deserialize();
     }
 
-    queue<ResponsePtr> responses;
-    {
-      LOG_DURATION("ProcessRequests responses generating");
-      for (auto& r : root.at("stat_requests").AsArray()) {
-        auto resp = MakeRequest(r)->Process(sprav_);
-        if (!resp->empty()) {
-          responses.emplace(move(resp));
+    for (auto& r : root.at("base_requests").AsArray()) {
+      MakeBaseRequest(r)->Process(sprav_);
+    }
+
+    sprav_->UpdateBase();
+    sprav_->Serialize();
+    PrintMemoryReport("update_base");
+  }
+
+  // Streams the input: the catalog starts loading as soon as its
+  // serialization settings are read, and every stat request is handed to
+  // the executor right after it is parsed. Responses are printed as they
+  // are ready, in the order of requests.
+  void ProcessRequests(std::istream& input) {
+    promise<void> loaded;
+    future<void> loading;
+    auto start_loading = [this, &loaded, &loading] {
+      if (loading.valid()) {
+        return;
+      }
+      loading = async(launch::async, [this, &loaded] {
+        try {
+          TRACE("ProcessRequests: Deserialization");
+          sprav_->Deserialize();
+          PrintMemoryReport("Deserialize");
+          loaded.set_value();
+        } catch (...) {
+          loaded.set_exception(current_exception());
+        }
+      });
+    };
+
+    RequestStats stats;
+    BlockingQueue<RequestPtr> requests(PENDING_REQUESTS_CAPACITY);
+    auto executing = async(launch::async, [this, &requests, loaded = loaded.get_future(), &stats]() mutable {
+      try {
+        ExecuteRequests(requests, loaded, stats);
+      } catch (...) {
+        requests.Close();
+        throw;
+      }
+    });
+
+    auto push = [&requests, &executing](RequestPtr request) {
+      if (!requests.Push(move(request))) {
+        // The executor has failed, get its error
+        executing.get();
+      }
+    };
+    // The executor waits for the catalog before popping anything: requests
+    // coming ahead of the serialization settings are kept here, a full
+    // queue would block the parsing forever
+    vector<RequestPtr> early_requests;
+    auto push_early_requests = [&push, &early_requests] {
+      for (auto& request : early_requests) {
+        push(move(request));
+      }
+      early_requests.clear();
+    };
+
+    try {
+      TRACE("ProcessRequests: parsing");
+      Json::LoadDictItems(input, [&](string key, istream& input) {
+        if (key == "serialization_settings") {
+          sprav_->SetSerializationSettings({Json::LoadNode(input).AsDict()});
+          start_loading();
+          push_early_requests();
+        } else if (key == "stat_requests") {
+          Json::LoadArrayItems(input, [&](Json::Node node) {
+            if (loading.valid()) {
+              push(MakeRequest(node));
+            } else {
+              early_requests.push_back(MakeRequest(node));
+            }
+          });
+        } else {
+          Json::LoadNode(input);
         }
+      });
+    } catch (...) {
+      requests.Close();
+      if (!loading.valid()) {
+        loaded.set_exception(current_exception());
+      }
+      if (executing.valid()) {
+        executing.wait();
       }
+      throw;
     }
 
-    {
-      LOG_DURATION("ProcessRequests: Output");
-      Output(std::move(responses));
+    start_loading();
+    push_early_requests();
+    requests.Close();
+    executing.get();
+
+    cerr << "Request latencies:\n";
+    stats.Print(cerr);
+    PrintCacheStats();
+  }
+
+  void ExecuteRequests(BlockingQueue<RequestPtr>& requests, future<void>& loaded, RequestStats& stats) {
+    loaded.get();
+
+    TRACE("ProcessRequests: executing");
+    os_ << "[";
+    bool first = true;
+    while (auto request = requests.Pop()) {
+      const auto start = chrono::steady_clock::now();
+      auto response = (*request)->Process(sprav_);
+      const uint64_t process_ns = ElapsedNs(start);
+      if (!response->empty()) {
+        OutputResponse(**request, *response, process_ns, first, stats);
+        first = false;
+      } else {
+        stats.Add((*request)->GetType(), (*request)->GetId(), process_ns, 0);
+      }
     }
+    os_ << "]\n";
   }
 
   SpravPtr sprav_;
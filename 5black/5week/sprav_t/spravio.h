@@ -11,6 +11,7 @@ class SpravIO {
  public:
   enum class Mode {
     MAKE_BASE,
+    UPDATE_BASE,
     PROCESS_REQUESTS
   };
 
@@ -1,15 +1,723 @@
 #include "spravio_tests.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "blocking_queue.h"
+#include "geo_distance.h"
+#include "json.h"
+#include "request.h"
+#include "request_stats.h"
+#include "sprav.h"
+#include "spravio.h"
+
 using namespace std;
 
 namespace SpravIOTests {
 
+namespace {
+
+const string BASE_SETTINGS = R"(
+  "routing_settings": {"bus_wait_time": 2, "bus_velocity": 30, "pedestrian_velocity": 5},
+  "render_settings": {
+    "width": 600, "height": 400, "padding": 50, "outer_margin": 100,
+    "stop_radius": 5, "company_radius": 6, "line_width": 14, "company_line_width": 4,
+    "bus_label_font_size": 20, "bus_label_offset": [7, 15],
+    "stop_label_font_size": 18, "stop_label_offset": [7, -3],
+    "underlayer_color": [255, 255, 255, 0.85], "underlayer_width": 3,
+    "color_palette": ["green", [255, 160, 0], "red"],
+    "layers": ["bus_lines", "bus_labels", "stop_points", "stop_labels"]
+  },)";
+
+const string NO_PAGES = R"({"rubrics": {}, "companies": []})";
+
+// Companies near stops of GetCatalog()
+const string PAGES = R"({
+  "rubrics": {"1": {"name": "Park"}, "2": {"name": "Cafe"}},
+  "companies": [
+    {"names": [{"value": "Park"}], "rubrics": [1], "nearby_stops": [{"name": "B", "meters": 250}]},
+    {"names": [{"value": "Cafe Central"}, {"value": "Central Coffee", "type": "SYNONYM"}], "rubrics": [2],
+     "phones": [{"number": "1234567"}], "urls": [{"value": "central.cafe"}],
+     "nearby_stops": [{"name": "D", "meters": 500}]},
+    {"names": [{"value": "Cafe Corner"}], "rubrics": [2], "nearby_stops": [{"name": "A", "meters": 100}]}
+  ]
+})";
+
+const vector<string> STOPS = {"A", "B", "C", "D", "E"};
+
+string Process(SpravPtr sprav, SpravIO::Mode mode, const string& input) {
+  istringstream is(input);
+  ostringstream os;
+  SpravIO(move(sprav), mode, os).Process(is);
+  return os.str();
+}
+
+string SerializationSettings(const string& file) {
+  return R"("serialization_settings": {"file": ")" + file + R"("})";
+}
+
+string StopRequest(const string& name, double lat, double lon, const string& distances) {
+  ostringstream os;
+  os << R"({"type": "Stop", "name": ")" << name << R"(", "latitude": )" << lat
+     << R"(, "longitude": )" << lon << R"(, "road_distances": {)" << distances << "}}";
+  return os.str();
+}
+
+string BusRequest(const string& name, const vector<string>& stops, bool is_roundtrip) {
+  string request = R"({"type": "Bus", "name": ")" + name + R"(", "stops": [)";
+  for (size_t i = 0; i < stops.size(); ++i) {
+    request += (i ? ", \"" : "\"") + stops[i] + "\"";
+  }
+  return request + "], \"is_roundtrip\": " + (is_roundtrip ? "true" : "false") + "}";
+}
+
+string Join(const vector<string>& items) {
+  string joined;
+  for (const auto& item : items) {
+    joined += (joined.empty() ? "" : ", ") + item;
+  }
+  return joined;
+}
+
+string MakeBase(const string& file, const vector<string>& base_requests, const string& pages = NO_PAGES) {
+  return Process(make_shared<Sprav>(), SpravIO::Mode::MAKE_BASE,
+      "{" + SerializationSettings(file) + "," + BASE_SETTINGS + R"("yellow_pages": )" + pages + "," +
+      R"("base_requests": [)" + Join(base_requests) + "]}");
+}
+
+string UpdateBase(const string& file, const vector<string>& base_requests) {
+  return Process(make_shared<Sprav>(), SpravIO::Mode::UPDATE_BASE,
+      "{" + SerializationSettings(file) +
+      R"(, "base_requests": [)" + Join(base_requests) + "]}");
+}
+
+// Stops STOPS with buses "1" and "2"
+vector<string> GetCatalog() {
+  return {
+    StopRequest("A", 55.60, 37.60, R"("B": 1500, "C": 2900, "D": 4000)"),
+    StopRequest("B", 55.61, 37.61, R"("C": 1700, "E": 3100)"),
+    StopRequest("C", 55.62, 37.63, R"("D": 2300, "B": 1900, "E": 3300)"),
+    StopRequest("D", 55.64, 37.62, R"("E": 2600)"),
+    StopRequest("E", 55.63, 37.66, R"("A": 5200)"),
+    BusRequest("1", {"A", "B", "C"}, false),
+    BusRequest("2", {"C", "D"}, false),
+  };
+}
+
+SpravPtr LoadCatalog(const vector<string>& base_requests) {
+  const string file = "test_catalog.bin";
+  MakeBase(file, base_requests);
+  auto sprav = make_shared<Sprav>();
+  sprav->SetSerializationSettings({Json::Dict{{"file", file}}});
+  sprav->Deserialize();
+  remove(file.c_str());
+  return sprav;
+}
+
+string Print(const Json::Node& node) {
+  ostringstream os;
+  Json::PrintNode(node, os);
+  return os.str();
+}
+
+// Every bus and stop, and the routes between all the stops
+string ProcessStatRequests(const string& file, const vector<string>& buses) {
+  vector<string> requests;
+  int id = 0;
+  for (const auto& bus : buses) {
+    requests.push_back(R"({"id": )" + to_string(++id) + R"(, "type": "Bus", "name": ")" + bus + "\"}");
+  }
+  for (const auto& from : STOPS) {
+    requests.push_back(R"({"id": )" + to_string(++id) + R"(, "type": "Stop", "name": ")" + from + "\"}");
+    for (const auto& to : STOPS) {
+      requests.push_back(R"({"id": )" + to_string(++id) + R"(, "type": "Route", "from": ")" + from +
+                         R"(", "to": ")" + to + "\"}");
+    }
+  }
+  return Process(make_shared<Sprav>(), SpravIO::Mode::PROCESS_REQUESTS,
+      "{" + SerializationSettings(file) + R"(, "stat_requests": [)" + Join(requests) + "]}");
+}
+
+// Responses of process_requests, parsed back. Maps are dropped: they are
+// escaped JSON strings, and the loader does not unescape strings.
+Json::Array ProcessResponses(const string& file, const vector<string>& requests) {
+  string output = Process(make_shared<Sprav>(), SpravIO::Mode::PROCESS_REQUESTS,
+      "{" + SerializationSettings(file) + R"(, "stat_requests": [)" + Join(requests) + "]}");
+  const string map_key = R"("map": ")";
+  for (size_t begin = output.find(map_key); begin != string::npos; begin = output.find(map_key, begin)) {
+    size_t end = begin + map_key.size();
+    while (output[end] != '"') {
+      end += output[end] == '\\' ? 2 : 1;
+    }
+    ++end;
+    if (output.compare(end, 2, ", ") == 0) {
+      end += 2;
+    }
+    output.erase(begin, end - begin);
+  }
+  istringstream is(output);
+  return Json::Load(is).GetRoot().AsArray();
+}
+
+bool IsNear(double lhs, double rhs) {
+  return abs(lhs - rhs) < 1e-6;
+}
+
+// Segments ridden by the route, as pairs of consecutive stop ids
+set<pair<size_t, size_t>> GetRideSegments(const Sprav::Route& route) {
+  set<pair<size_t, size_t>> segments;
+  for (const auto& item : route) {
+    const auto stops = route.GetStops(item);
+    for (auto it = stops.begin(); it != stops.end() && next(it) != stops.end(); ++it) {
+      segments.emplace(*it, *next(it));
+    }
+  }
+  return segments;
+}
+
+} // namespace
+
 void Test() {
 
 }
 
+void TestUpdateBase() {
+  // A few new edges are added to the router, a long bus rebuilds it.
+  // Its segments are not ridden by other buses: routes of the same time
+  // would depend on the order of the edges.
+  const string small_bus = BusRequest("3", {"B", "E"}, false);
+  const string large_bus = BusRequest("4", {"A", "C", "E", "D", "A", "C", "E", "D", "A"}, true);
+
+  const string updated_file = "test_update_base_updated.bin";
+  const string rebuilt_file = "test_update_base_rebuilt.bin";
+  auto base_requests = GetCatalog();
+  MakeBase(updated_file, base_requests);
+
+  vector<string> bus_names = {"1", "2"};
+  // The updated base answers as the one made from the whole catalog
+  auto check = [&] {
+    MakeBase(rebuilt_file, base_requests);
+    const auto expected = ProcessStatRequests(rebuilt_file, bus_names);
+    ASSERT_EQUAL(ProcessStatRequests(updated_file, bus_names), expected);
+    return expected;
+  };
+
+  for (const auto& [bus, name] : {pair{small_bus, "3"}, pair{large_bus, "4"}}) {
+    UpdateBase(updated_file, {bus});
+    base_requests.push_back(bus);
+    bus_names.push_back(name);
+    ASSERT(check().find("not found") == string::npos);
+  }
+
+  // A changed bus
+  const string changed_bus = BusRequest("3", {"B", "E", "D"}, false);
+  UpdateBase(updated_file, {changed_bus});
+  replace(base_requests.begin(), base_requests.end(), small_bus, changed_bus);
+  const auto expected = check();
+  ASSERT(expected.find("not found") == string::npos);
+
+  // E is still ridden by buses 3 and 4, the base is left as it was
+  const string removed_stop = R"({"type": "Stop", "name": "E", "removed": true})";
+  bool failed = false;
+  try {
+    UpdateBase(updated_file, {removed_stop});
+  } catch (const runtime_error& e) {
+    failed = string(e.what()).find("Failed to remove stop E: it is used by bus") == 0;
+  }
+  ASSERT(failed);
+  ASSERT_EQUAL(ProcessStatRequests(updated_file, bus_names), expected);
+
+  // Removed with its buses, E drops out of road distances too
+  UpdateBase(updated_file, {
+    removed_stop,
+    R"({"type": "Bus", "name": "3", "removed": true})",
+    R"({"type": "Bus", "name": "4", "removed": true})",
+  });
+  base_requests = {
+    StopRequest("A", 55.60, 37.60, R"("B": 1500, "C": 2900, "D": 4000)"),
+    StopRequest("B", 55.61, 37.61, R"("C": 1700)"),
+    StopRequest("C", 55.62, 37.63, R"("D": 2300, "B": 1900)"),
+    StopRequest("D", 55.64, 37.62, {}),
+    BusRequest("1", {"A", "B", "C"}, false),
+    BusRequest("2", {"C", "D"}, false),
+  };
+  const auto removed = check();
+  ASSERT(removed.find(R"({"error_message": "not found", "request_id": 4})") != string::npos);
+
+  remove(updated_file.c_str());
+  remove(rebuilt_file.c_str());
+}
+
+void TestStatRequestsFirst() {
+  const string file = "test_stat_requests_first.bin";
+  MakeBase(file, {
+    StopRequest("A", 55.60, 37.60, R"("B": 1500)"),
+    StopRequest("B", 55.61, 37.61, {}),
+    BusRequest("1", {"A", "B"}, false),
+  });
+
+  // More than the executor queue takes before the catalog is loaded
+  vector<string> requests;
+  for (int id = 1; id <= 5000; ++id) {
+    requests.push_back(R"({"id": )" + to_string(id) + R"(, "type": "Bus", "name": "1"})");
+  }
+  const string stat_requests = R"("stat_requests": [)" + Join(requests) + "]";
+  const auto expected = Process(make_shared<Sprav>(), SpravIO::Mode::PROCESS_REQUESTS,
+      "{" + SerializationSettings(file) + ", " + stat_requests + "}");
+  ASSERT(expected.find(R"("request_id": 5000)") != string::npos);
+  ASSERT_EQUAL(Process(make_shared<Sprav>(), SpravIO::Mode::PROCESS_REQUESTS,
+      "{" + stat_requests + ", " + SerializationSettings(file) + "}"), expected);
+
+  remove(file.c_str());
+}
+
+void TestRouteItems() {
+  auto base_requests = GetCatalog();
+  base_requests.push_back(BusRequest("3", {"B", "E"}, false));
+  const auto catalog = LoadCatalog(base_requests);
+  const Sprav& sprav = *catalog;
+
+  for (const auto& from : STOPS) {
+    for (const auto& to : STOPS) {
+      const auto route = sprav.FindRoute(from, to);
+      const auto info = sprav.GetRouter()->BuildRoute(sprav.FindStop(from)->id * 2 + 1, sprav.FindStop(to)->id * 2 + 1);
+      ASSERT(route && info);
+      ASSERT_EQUAL(route.GetTotalTime(), info->weight);
+
+      // The expanded route: an item per edge, consecutive rides of a bus
+      // make one item
+      auto item = route.begin();
+      vector<size_t> ride_stops;
+      for (size_t idx = 0; idx < info->edge_count; ++idx) {
+        const auto& edge = sprav.GetRouter()->GetRouteEdge(info->id, idx);
+        ASSERT(item != route.end());
+        ASSERT(item->type == edge.extra.type);
+        if (edge.extra.type == RoutePartType::WAIT_BUS) {
+          ASSERT_EQUAL(item->name, sprav.GetStop(edge.extra.id).name);
+          ASSERT_EQUAL(item->time, edge.weight);
+          ++item;
+          continue;
+        }
+
+        ASSERT_EQUAL(item->name, sprav.GetBus(edge.extra.id).name);
+        ride_stops.insert(ride_stops.end(), edge.extra.stops.begin(), edge.extra.stops.end());
+        const bool ride_ends = idx + 1 == info->edge_count
+            || sprav.GetRouter()->GetRouteEdge(info->id, idx + 1).extra.type != RoutePartType::RIDE_BUS
+            || sprav.GetRouter()->GetRouteEdge(info->id, idx + 1).extra.id != edge.extra.id;
+        if (ride_ends) {
+          const auto stops = route.GetStops(*item);
+          ASSERT(equal(stops.begin(), stops.end(), ride_stops.begin(), ride_stops.end()));
+          ride_stops.clear();
+          ++item;
+        }
+      }
+      ASSERT(item == route.end());
+      sprav.GetRouter()->ReleaseRoute(info->id);
+    }
+  }
+
+  // Two transfers: bus "3" from E, "1" from B, "2" from C
+  const auto route = sprav.FindRoute("E", "D");
+  const vector<pair<RoutePartType, string>> expected = {
+    {RoutePartType::WAIT_BUS, "E"}, {RoutePartType::RIDE_BUS, "3"},
+    {RoutePartType::WAIT_BUS, "B"}, {RoutePartType::RIDE_BUS, "1"},
+    {RoutePartType::WAIT_BUS, "C"}, {RoutePartType::RIDE_BUS, "2"},
+  };
+  ASSERT_EQUAL(route.size(), expected.size());
+  for (size_t idx = 0; idx < expected.size(); ++idx) {
+    ASSERT(route[idx].type == expected[idx].first);
+    ASSERT_EQUAL(route[idx].name, expected[idx].second);
+  }
+  ASSERT_EQUAL(route[3].span_count, 1u);
+  const auto stops = route.GetStops(route[3]);
+  ASSERT_EQUAL(vector<size_t>(stops.begin(), stops.end()),
+               (vector<size_t>{sprav.FindStop("B")->id, sprav.FindStop("C")->id}));
+}
+
+void TestSharedMaps() {
+  const auto sprav = LoadCatalog(GetCatalog());
+  const vector<Json::Dict> requests = {
+    {{"id", 1}, {"type", "Map"}},
+    {{"id", 2}, {"type", "Route"}, {"from", "A"}, {"to", "D"}},
+  };
+  for (const auto& request : requests) {
+    auto first = MakeRequest(request)->Process(sprav)->AsJson().AsDict();
+    auto second = MakeRequest(request)->Process(sprav)->AsJson().AsDict();
+    const auto& first_map = get<Json::Raw>(first.at("map").GetBase());
+    const auto& second_map = get<Json::Raw>(second.at("map").GetBase());
+    ASSERT(first_map.text == second_map.text);
+
+    // Printed as if the map were an ordinary string node
+    const auto shared = Print(first);
+    first["map"] = request.at("type").AsString() == "Map"
+        ? sprav->GetMap()
+        : sprav->GetRouteMap(sprav->FindRoute("A", "D"));
+    ASSERT_EQUAL(shared, Print(first));
+  }
+}
+
+void TestRouteMapKeys() {
+  const auto sprav = LoadCatalog({
+    StopRequest("A", 55.600, 37.60, R"("B": 1000)"),
+    StopRequest("B", 55.609, 37.60, R"("C": 1000)"),
+    StopRequest("C", 55.618, 37.60, {}),
+    BusRequest("1", {"A", "B", "C"}, false),
+  });
+  const auto get_map = [&sprav](const string& from, const string& to) {
+    const Json::Dict request = {{"id", 1}, {"type", "Route"}, {"from", from}, {"to", to}};
+    const auto response = MakeRequest(request)->Process(sprav)->AsJson().AsDict();
+    return *get<Json::Raw>(response.at("map").GetBase()).text;
+  };
+
+  // Both routes print the same items, but ride different stops
+  ASSERT_EQUAL(Print(sprav->FindRoute("B", "A").AsJson()), Print(sprav->FindRoute("B", "C").AsJson()));
+  const auto to_a = get_map("B", "A");
+  const auto to_c = get_map("B", "C");
+  ASSERT(to_a != to_c);
+  ASSERT_EQUAL(to_c, Print(sprav->GetRouteMap(sprav->FindRoute("B", "C"))));
+}
+
+void TestRouteAlternatives() {
+  // Two disjoint lines from A to D, the second is 0.8 minutes longer. The
+  // third one is too slow to be an alternative.
+  const vector<string> base_requests = {
+    StopRequest("A", 55.60, 37.60, R"("B": 1000, "C": 1200, "E": 5000)"),
+    StopRequest("B", 55.61, 37.59, R"("D": 1000)"),
+    StopRequest("C", 55.61, 37.61, R"("D": 1200)"),
+    StopRequest("D", 55.62, 37.60, R"("E": 5000)"),
+    StopRequest("E", 55.61, 37.64, {}),
+    BusRequest("1", {"A", "B", "D"}, false),
+    BusRequest("2", {"A", "C", "D"}, false),
+    BusRequest("3", {"A", "E", "D"}, false),
+  };
+  const string file = "test_route_alternatives.bin";
+  MakeBase(file, base_requests);
+
+  const auto responses = ProcessResponses(file, {
+    R"({"id": 1, "type": "Route", "from": "A", "to": "D", "max_alternatives": 2})",
+    R"({"id": 2, "type": "Route", "from": "A", "to": "D", "max_alternatives": 0})",
+  });
+  ASSERT_EQUAL(responses.size(), 2u);
+
+  const auto& with_alternatives = responses[0].AsDict();
+  ASSERT_EQUAL(with_alternatives.at("total_time").AsDouble(), 6.0);
+  const auto& alternatives = with_alternatives.at("alternatives").AsArray();
+  ASSERT_EQUAL(alternatives.size(), 1u);
+  const auto& alternative = alternatives[0].AsDict();
+  ASSERT(abs(alternative.at("total_time").AsDouble() - 6.8) < 1e-9);
+  const auto& items = alternative.at("items").AsArray();
+  ASSERT_EQUAL(items.size(), 2u);
+  ASSERT_EQUAL(items[1].AsDict().at("bus").AsString(), "2");
+
+  const auto& main_only = responses[1].AsDict();
+  ASSERT_EQUAL(main_only.count("alternatives"), 0u);
+  ASSERT_EQUAL(main_only.at("total_time").AsDouble(), 6.0);
+
+  // Stretch and shared rides limits, checked on the routes themselves
+  const auto sprav = LoadCatalog(base_requests);
+  const auto best = sprav->FindRoute("A", "D");
+  vector<set<pair<size_t, size_t>>> accepted = {GetRideSegments(best)};
+  for (const auto& route : sprav->FindRouteAlternatives("A", "D", 2)) {
+    ASSERT(route.GetTotalTime() <= best.GetTotalTime() * 1.5);
+    const auto segments = GetRideSegments(route);
+    for (const auto& other : accepted) {
+      const size_t shared = count_if(segments.begin(), segments.end(), [&other](const auto& s) { return other.count(s) > 0; });
+      ASSERT(shared <= 0.7 * segments.size());
+    }
+    accepted.push_back(segments);
+  }
+  ASSERT_EQUAL(accepted.size(), 2u);
+
+  bool rejected = false;
+  try {
+    ProcessResponses(file, {R"({"id": 3, "type": "Route", "from": "A", "to": "D", "max_alternatives": -1})"});
+  } catch (const invalid_argument&) {
+    rejected = true;
+  }
+  ASSERT(rejected);
+
+  remove(file.c_str());
+}
+
+void TestReachable() {
+  const string file = "test_reachable.bin";
+  MakeBase(file, GetCatalog(), PAGES);
+  const auto responses = ProcessResponses(file, {
+    R"({"id": 1, "type": "Reachable", "from": "A", "max_time": 12})",
+    R"({"id": 2, "type": "Reachable", "from": "A", "max_time": 12, "companies": {"rubrics": ["Cafe"]}})",
+    R"({"id": 3, "type": "Reachable", "from": "Z", "max_time": 12})",
+  });
+  remove(file.c_str());
+  ASSERT_EQUAL(responses.size(), 3u);
+
+  auto get_reached = [](const Json::Node& items) {
+    vector<pair<string, double>> reached;
+    for (const auto& item : items.AsArray()) {
+      reached.emplace_back(item.AsDict().at("name").AsString(), item.AsDict().at("time").AsDouble());
+    }
+    return reached;
+  };
+  auto assert_reached = [](const vector<pair<string, double>>& reached, const vector<pair<string, double>>& expected) {
+    ASSERT_EQUAL(reached.size(), expected.size());
+    for (size_t idx = 0; idx < expected.size(); ++idx) {
+      ASSERT_EQUAL(reached[idx].first, expected[idx].first);
+      ASSERT(IsNear(reached[idx].second, expected[idx].second));
+    }
+  };
+
+  // Bus "1" reaches B in 2 + 3 minutes and C in 2 + 6.4; D takes 15
+  // minutes, E has no bus. Companies are walked to at 5 km/h.
+  const auto& all = responses[0].AsDict();
+  assert_reached(get_reached(all.at("stops")), {{"A", 0}, {"B", 5}, {"C", 8.4}});
+  assert_reached(get_reached(all.at("companies")), {{"Cafe Corner", 1.2}, {"Park", 8}});
+
+  const auto& cafes = responses[1].AsDict();
+  assert_reached(get_reached(cafes.at("stops")), {{"A", 0}, {"B", 5}, {"C", 8.4}});
+  assert_reached(get_reached(cafes.at("companies")), {{"Cafe Corner", 1.2}});
+
+  ASSERT_EQUAL(responses[2].AsDict().at("error_message").AsString(), "not found");
+}
+
+void TestRouteMatrix() {
+  const string file = "test_route_matrix.bin";
+  MakeBase(file, GetCatalog());
+
+  // E has no bus and Z is no stop: their pairs are unreachable
+  const vector<string> sources = {"A", "C", "E", "Z"};
+  const vector<string> targets = {"A", "B", "D", "E"};
+  vector<string> requests = {
+    R"({"id": 1, "type": "RouteMatrix", "from": ["A", "C", "E", "Z"], "to": ["A", "B", "D", "E"], "with_routes": true})",
+    R"({"id": 2, "type": "RouteMatrix", "from": ["A", "C", "E", "Z"], "to": ["A", "B", "D", "E"]})",
+  };
+  int id = 2;
+  for (const auto& from : sources) {
+    for (const auto& to : targets) {
+      requests.push_back(R"({"id": )" + to_string(++id) + R"(, "type": "Route", "from": ")" + from +
+                         R"(", "to": ")" + to + "\"}");
+    }
+  }
+  const auto responses = ProcessResponses(file, requests);
+  remove(file.c_str());
+  ASSERT_EQUAL(responses.size(), requests.size());
+
+  const auto& with_routes = responses[0].AsDict();
+  const auto& times_only = responses[1].AsDict();
+  ASSERT_EQUAL(times_only.count("routes"), 0u);
+  ASSERT_EQUAL(Print(times_only.at("times")), Print(with_routes.at("times")));
+
+  size_t unreachable = 0;
+  for (size_t i = 0; i < sources.size(); ++i) {
+    for (size_t j = 0; j < targets.size(); ++j) {
+      const double time = with_routes.at("times").AsArray()[i].AsArray()[j].AsDouble();
+      const auto& matrix_route = with_routes.at("routes").AsArray()[i].AsArray()[j].AsDict();
+      const auto& route = responses[2 + i * targets.size() + j].AsDict();
+      if (route.count("error_message") > 0) {
+        ASSERT_EQUAL(time, -1.0);
+        ASSERT_EQUAL(matrix_route.at("error_message").AsString(), "not found");
+        ++unreachable;
+        continue;
+      }
+      ASSERT(IsNear(time, route.at("total_time").AsDouble()));
+      ASSERT(IsNear(matrix_route.at("total_time").AsDouble(), route.at("total_time").AsDouble()));
+      ASSERT_EQUAL(Print(matrix_route.at("items")), Print(route.at("items")));
+    }
+  }
+  // The Z row, the E row but E itself, and the E column of A and C
+  ASSERT_EQUAL(unreachable, 9u);
+}
+
+void TestNearestStops() {
+  const string file = "test_nearest_stops.bin";
+  MakeBase(file, GetCatalog());
+  const auto responses = ProcessResponses(file, {
+    R"({"id": 1, "type": "NearestStops", "latitude": 55.615, "longitude": 37.615})",
+    R"({"id": 2, "type": "NearestStops", "latitude": 55.615, "longitude": 37.615, "count": 3})",
+    R"({"id": 3, "type": "NearestStops", "latitude": 55.615, "longitude": 37.615, "count": 5, "radius": 1500})",
+    R"({"id": 4, "type": "NearestStops", "points": [{"latitude": 55.615, "longitude": 37.615},
+        {"latitude": 55.635, "longitude": 37.655}], "count": 2})",
+  });
+  remove(file.c_str());
+  ASSERT_EQUAL(responses.size(), 4u);
+
+  // Every stop measured from the point, nearest first
+  const auto sprav = LoadCatalog(GetCatalog());
+  auto get_nearest = [&sprav](double lat, double lon, size_t count, double radius) {
+    Geo::Points points;
+    const size_t point = points.Add(lat, lon);
+    Geo::IndexPairs pairs;
+    for (const auto& name : STOPS) {
+      const Stop* stop = sprav->FindStop(name);
+      pairs.emplace_back(point, points.Add(stop->lat, stop->lon));
+    }
+    const auto distances = points.GetDistances(pairs);
+    vector<pair<double, string>> nearest;
+    for (size_t idx = 0; idx < STOPS.size(); ++idx) {
+      if (distances[idx] <= radius) {
+        nearest.emplace_back(distances[idx], STOPS[idx]);
+      }
+    }
+    sort(nearest.begin(), nearest.end());
+    nearest.resize(min(nearest.size(), count));
+    return nearest;
+  };
+  // Distances are printed with 6 significant digits
+  auto assert_stops = [](const Json::Node& stops, const vector<pair<double, string>>& expected) {
+    ASSERT_EQUAL(stops.AsArray().size(), expected.size());
+    for (size_t idx = 0; idx < expected.size(); ++idx) {
+      const auto& stop = stops.AsArray()[idx].AsDict();
+      ASSERT_EQUAL(stop.at("name").AsString(), expected[idx].second);
+      ASSERT(abs(stop.at("distance").AsDouble() - expected[idx].first) < 0.01);
+    }
+  };
+
+  const double no_radius = numeric_limits<double>::max();
+  assert_stops(responses[0].AsDict().at("stops"), get_nearest(55.615, 37.615, 1, no_radius));
+  assert_stops(responses[1].AsDict().at("stops"), get_nearest(55.615, 37.615, 3, no_radius));
+  const auto within_radius = get_nearest(55.615, 37.615, 5, 1500);
+  ASSERT_EQUAL(within_radius.size(), 2u);
+  assert_stops(responses[2].AsDict().at("stops"), within_radius);
+
+  const auto& results = responses[3].AsDict().at("results").AsArray();
+  ASSERT_EQUAL(results.size(), 2u);
+  assert_stops(results[0].AsDict().at("stops"), get_nearest(55.615, 37.615, 2, no_radius));
+  assert_stops(results[1].AsDict().at("stops"), get_nearest(55.635, 37.655, 2, no_radius));
+}
+
+void TestSuggestCompanies() {
+  // The index is built by make_base and read back by process_requests
+  const string file = "test_suggest_companies.bin";
+  MakeBase(file, GetCatalog(), PAGES);
+  const auto responses = ProcessResponses(file, {
+    R"({"id": 1, "type": "SuggestCompanies", "query": "caf"})",
+    R"({"id": 2, "type": "SuggestCompanies", "query": "c", "count": 1})",
+    R"({"id": 3, "type": "SuggestCompanies", "query": "Central Co"})",
+    R"({"id": 4, "type": "SuggestCompanies", "query": "cafw"})",
+    R"({"id": 5, "type": "SuggestCompanies", "query": "cafw", "max_distance": 0})",
+    R"({"id": 6, "type": "SuggestCompanies", "query": "pz"})",
+    R"({"id": 7, "type": "SuggestCompanies", "query": "pz", "max_distance": 1})",
+  });
+  remove(file.c_str());
+  ASSERT_EQUAL(responses.size(), 7u);
+
+  auto get_found = [&responses](size_t idx) {
+    vector<pair<string, int>> found;
+    for (const auto& company : responses[idx].AsDict().at("companies").AsArray()) {
+      found.emplace_back(company.AsDict().at("name").AsString(), company.AsDict().at("distance").AsInt());
+    }
+    return found;
+  };
+  using Found = vector<pair<string, int>>;
+
+  // Cafe Central has a phone and an url, it ranks first
+  ASSERT_EQUAL(get_found(0), (Found{{"Cafe Central", 0}, {"Cafe Corner", 0}}));
+  ASSERT_EQUAL(get_found(1), (Found{{"Cafe Central", 0}}));
+  // Found by the synonym, named by the main name
+  ASSERT_EQUAL(get_found(2), (Found{{"Cafe Central", 0}}));
+  // Four letters take one typo by default, two letters none
+  ASSERT_EQUAL(get_found(3), (Found{{"Cafe Central", 1}, {"Cafe Corner", 1}}));
+  ASSERT_EQUAL(get_found(4), Found{});
+  ASSERT_EQUAL(get_found(5), Found{});
+  ASSERT_EQUAL(get_found(6), (Found{{"Park", 1}}));
+}
+
+void TestLatencyHistogram() {
+  LatencyHistogram histogram;
+  ASSERT_EQUAL(histogram.GetPercentile(0.5), 0u);
+
+  for (uint64_t ns = 1; ns <= 1000; ++ns) {
+    histogram.Add(ns);
+  }
+  ASSERT_EQUAL(histogram.GetCount(), 1000u);
+  ASSERT_EQUAL(histogram.GetMax(), 1000u);
+  // Buckets are a quarter of an octave wide
+  for (auto [q, exact] : {pair{0.5, 500.0}, pair{0.9, 900.0}, pair{0.99, 990.0}}) {
+    const auto p = histogram.GetPercentile(q);
+    ASSERT(p >= exact && p <= exact * 1.25);
+  }
+  ASSERT_EQUAL(histogram.GetPercentile(1), 1000u);
+
+  RequestStats stats(2);
+  stats.Add(RequestType::ROUTE, 1, 10, 1);
+  stats.Add(RequestType::MAP, 2, 1000, 500);
+  stats.Add(RequestType::ROUTE, 3, 300, 0);
+  stats.Add(RequestType::STAT_BUS, 4, 5, 5);
+  ASSERT_EQUAL(stats.GetProcess(RequestType::ROUTE).GetCount(), 2u);
+  ASSERT_EQUAL(stats.GetJson(RequestType::MAP).GetMax(), 500u);
+
+  const auto slowest = stats.GetSlowest();
+  ASSERT_EQUAL(slowest.size(), 2u);
+  ASSERT_EQUAL(slowest[0].id, 2u);
+  ASSERT_EQUAL(slowest[1].id, 3u);
+}
+
+void TestStreamingJson() {
+  istringstream input(R"({"skipped": {"a": [1, 2]}, "items": [{"id": 1}, 2, "three"], "last": true})");
+  vector<string> keys;
+  vector<Json::Node> items;
+  Json::LoadDictItems(input, [&](string key, istream& input) {
+    keys.push_back(key);
+    if (key == "items") {
+      Json::LoadArrayItems(input, [&items](Json::Node node) {
+        items.push_back(move(node));
+      });
+    } else {
+      Json::LoadNode(input);
+    }
+  });
+  ASSERT_EQUAL(keys, (vector<string>{"skipped", "items", "last"}));
+  ASSERT_EQUAL(items.size(), 3u);
+  ASSERT_EQUAL(items[0].AsDict().at("id").AsInt(), 1);
+  ASSERT_EQUAL(items[1].AsInt(), 2);
+  ASSERT_EQUAL(items[2].AsString(), "three");
+
+  istringstream not_array("{}");
+  bool thrown = false;
+  try {
+    Json::LoadArrayItems(not_array, [](Json::Node) {});
+  } catch (const runtime_error&) {
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+void TestBlockingQueue() {
+  BlockingQueue<int> queue(2);
+  thread producer([&queue] {
+    for (int i = 0; i < 100; ++i) {
+      queue.Push(i);
+    }
+    queue.Close();
+  });
+  int expected = 0;
+  while (auto value = queue.Pop()) {
+    ASSERT_EQUAL(*value, expected++);
+  }
+  producer.join();
+  ASSERT_EQUAL(expected, 100);
+  ASSERT(!queue.Push(100));
+}
+
 }
 
 void TestSpravIO(TestRunner& tr) {
   RUN_TEST(tr, SpravIOTests::Test);
-}
\ No newline at end of file
+  RUN_TEST(tr, SpravIOTests::TestLatencyHistogram);
+  RUN_TEST(tr, SpravIOTests::TestStreamingJson);
+  RUN_TEST(tr, SpravIOTests::TestBlockingQueue);
+  RUN_TEST(tr, SpravIOTests::TestUpdateBase);
+  RUN_TEST(tr, SpravIOTests::TestStatRequestsFirst);
+  RUN_TEST(tr, SpravIOTests::TestRouteItems);
+  RUN_TEST(tr, SpravIOTests::TestSharedMaps);
+  RUN_TEST(tr, SpravIOTests::TestRouteMapKeys);
+  RUN_TEST(tr, SpravIOTests::TestRouteAlternatives);
+  RUN_TEST(tr, SpravIOTests::TestReachable);
+  RUN_TEST(tr, SpravIOTests::TestRouteMatrix);
+  RUN_TEST(tr, SpravIOTests::TestNearestStops);
+  RUN_TEST(tr, SpravIOTests::TestSuggestCompanies);
+}
@@ -31,12 +31,22 @@ void Stop::SerializeTo(SpravSerialize::Stop& m) const {
   for (auto bus : buses) {
     m.mutable_bus()->Add(bus);
   }
+  m.set_lat(lat);
+  m.set_lon(lon);
+  for (auto [other, distance] : road_distances) {
+    (*m.mutable_road_distances())[other] = distance;
+  }
 }
 
 Stop Stop::Parse(const SpravSerialize::Stop& m) {
   Stop s;
   s.id = m.id();
   s.buses.insert(m.bus().begin(), m.bus().end());
+  s.lat = m.lat();
+  s.lon = m.lon();
+  for (const auto& [other, distance] : m.road_distances()) {
+    s.road_distances[other] = distance;
+  }
 
   return s;
 }
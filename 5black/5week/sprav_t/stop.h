@@ -14,6 +14,7 @@ struct Stop {
   double lon;
   std::set<size_t> buses;
   std::unordered_map<size_t, int> distances;
+  std::unordered_map<size_t, int> road_distances;
 
   int DistanceTo(size_t other) const;
 
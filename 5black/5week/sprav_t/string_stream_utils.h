@@ -12,6 +12,11 @@
 
 using namespace std;
 
+template <class K, class V>
+ostream& operator << (ostream& os, const pair<K, V>& p) {
+  return os << "(" << p.first << ": " << p.second << ")";
+}
+
 template <class T>
 ostream& operator << (ostream& os, const vector<T>& s) {
   os << "{";
@@ -72,11 +77,6 @@ ostream& operator << (ostream& os, const unordered_set<T>& s) {
   return os << "}";
 }
 
-template <class K, class V>
-ostream& operator << (ostream& os, const pair<K, V>& p) {
-  return os << "(" << p.first << ": " << p.second << ")";
-}
-
 template <class K, class V>
 ostream& operator << (ostream& os, const map<K, V>& m) {
   os << "{";
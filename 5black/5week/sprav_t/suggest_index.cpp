@@ -0,0 +1,243 @@
+#include "suggest_index.h"
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+
+#include "memory_report.h"
+
+using namespace std;
+
+namespace {
+
+// Case folding for Latin and Cyrillic letters, ё is searched as е
+uint32_t ToLower(uint32_t c) {
+  if (c >= 'A' && c <= 'Z') {
+    return c + ('a' - 'A');
+  }
+  if (c >= 0x410 && c <= 0x42F) {
+    return c + 0x20;
+  }
+  if (c == 0x401 || c == 0x451) {
+    return 0x435;
+  }
+  return c;
+}
+
+// Code points of UTF-8 text, a byte that starts no valid sequence is
+// taken as is
+vector<uint32_t> Normalize(string_view s) {
+  vector<uint32_t> result;
+  result.reserve(s.size());
+  for (size_t i = 0; i < s.size(); ) {
+    const unsigned char c = s[i];
+    size_t length = c < 0x80 ? 1 : c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+    if (i + length > s.size()) {
+      length = 1;
+    }
+    uint32_t code = length == 1 ? c : c & (0x7F >> length);
+    for (size_t k = 1; k < length; ++k) {
+      code = (code << 6) | (s[i + k] & 0x3F);
+    }
+    result.push_back(ToLower(code));
+    i += length;
+  }
+  return result;
+}
+
+struct BuildNode {
+  map<uint32_t, size_t> children;
+  vector<uint32_t> ids;
+};
+
+} // namespace
+
+struct SuggestIndex::Search {
+  const vector<uint32_t>& query;
+  // Edit distances between the query prefixes and the key of the node at
+  // each depth of the current path
+  vector<vector<size_t>> rows;
+  Found& found;
+};
+
+SuggestIndex::SuggestIndex(const vector<Entry>& entries, vector<uint32_t> scores)
+  : scores_(move(scores))
+{
+  vector<BuildNode> nodes(1);
+  for (const auto& entry : entries) {
+    size_t node = 0;
+    for (uint32_t c : Normalize(entry.name)) {
+      auto [it, inserted] = nodes[node].children.emplace(c, nodes.size());
+      if (inserted) {
+        nodes.emplace_back();
+      }
+      node = it->second;
+    }
+    nodes[node].ids.push_back(entry.company_id);
+  }
+
+  // Breadth first numbering, order[i] is the build node numbered i
+  vector<size_t> order{0};
+  order.reserve(nodes.size());
+  labels_.reserve(nodes.size());
+  labels_.push_back(0);
+  first_child_.reserve(nodes.size() + 1);
+  for (size_t i = 0; i < order.size(); ++i) {
+    first_child_.push_back(order.size());
+    for (auto [label, child] : nodes[order[i]].children) {
+      order.push_back(child);
+      labels_.push_back(label);
+    }
+  }
+  first_child_.push_back(order.size());
+
+  // Children are numbered after their parent, so going backwards every
+  // subtree is ready before its root
+  vector<vector<uint32_t>> tops(order.size());
+  for (size_t i = order.size(); i-- > 0; ) {
+    auto& top = tops[i];
+    top = move(nodes[order[i]].ids);
+    for (size_t child = first_child_[i]; child < first_child_[i + 1]; ++child) {
+      top.insert(top.end(), tops[child].begin(), tops[child].end());
+    }
+    sort(top.begin(), top.end());
+    top.erase(unique(top.begin(), top.end()), top.end());
+    const size_t size = min(top.size(), MAX_COUNT);
+    partial_sort(top.begin(), top.begin() + size, top.end(), [this](uint32_t lhs, uint32_t rhs) {
+      return Better(lhs, rhs);
+    });
+    top.resize(size);
+  }
+
+  top_offsets_.reserve(order.size() + 1);
+  top_offsets_.push_back(0);
+  for (const auto& top : tops) {
+    top_ids_.insert(top_ids_.end(), top.begin(), top.end());
+    top_offsets_.push_back(top_ids_.size());
+  }
+}
+
+SuggestIndex::SuggestIndex(const SpravSerialize::SuggestIndex& m)
+  : first_child_(m.first_child().begin(), m.first_child().end())
+  , labels_(m.labels().begin(), m.labels().end())
+  , top_offsets_(m.top_offsets().begin(), m.top_offsets().end())
+  , top_ids_(m.top_ids().begin(), m.top_ids().end())
+  , scores_(m.scores().begin(), m.scores().end())
+{}
+
+void SuggestIndex::Serialize(SpravSerialize::SuggestIndex& m) const {
+  m.mutable_first_child()->Add(first_child_.begin(), first_child_.end());
+  m.mutable_labels()->Add(labels_.begin(), labels_.end());
+  m.mutable_top_offsets()->Add(top_offsets_.begin(), top_offsets_.end());
+  m.mutable_top_ids()->Add(top_ids_.begin(), top_ids_.end());
+  m.mutable_scores()->Add(scores_.begin(), scores_.end());
+}
+
+SuggestIndex::Found SuggestIndex::Suggest(string_view query, size_t count, size_t max_distance) const {
+  Found found;
+  if (labels_.empty()) {
+    return found;
+  }
+  count = min(count, MAX_COUNT);
+  max_distance = min(max_distance, MAX_DISTANCE);
+  const auto letters = Normalize(query);
+
+  if (FindPrefix(letters, found); found.size() >= count || max_distance == 0) {
+    found.resize(min(found.size(), count));
+    return found;
+  }
+
+  // Distances grow pass by pass: count companies matching closer leave
+  // no place for the farther ones, and their search is the wide one
+  Search search{letters, {}, found};
+  search.rows.emplace_back(letters.size() + 1);
+  iota(search.rows[0].begin(), search.rows[0].end(), 0);
+  for (size_t distance = 1; distance <= max_distance && found.size() < count; ++distance) {
+    found.clear();
+    Find(0, 0, distance + 1, search);
+
+    // A company may be found under several nodes: keep its closest match
+    sort(found.begin(), found.end());
+    found.erase(unique(found.begin(), found.end(), [](const auto& lhs, const auto& rhs) {
+      return lhs.first == rhs.first;
+    }), found.end());
+  }
+
+  const size_t size = min(found.size(), count);
+  partial_sort(found.begin(), found.begin() + size, found.end(), [this](const auto& lhs, const auto& rhs) {
+    if (lhs.second != rhs.second) {
+      return lhs.second < rhs.second;
+    }
+    return Better(lhs.first, rhs.first);
+  });
+  found.resize(size);
+  return found;
+}
+
+size_t SuggestIndex::GetDefaultDistance(string_view query) {
+  const size_t letters = Normalize(query).size();
+  return letters < 3 ? 0 : letters < 6 ? 1 : 2;
+}
+
+size_t SuggestIndex::Size() const {
+  return labels_.size();
+}
+
+size_t SuggestIndex::GetMemoryUsage() const {
+  return Memory::GetHeapSize(first_child_) + Memory::GetHeapSize(labels_)
+      + Memory::GetHeapSize(top_offsets_) + Memory::GetHeapSize(top_ids_) + Memory::GetHeapSize(scores_);
+}
+
+bool SuggestIndex::Better(uint32_t lhs, uint32_t rhs) const {
+  return scores_[lhs] != scores_[rhs] ? scores_[lhs] > scores_[rhs] : lhs < rhs;
+}
+
+// Walks the subtrees where the query may still match within the allowed
+// distance. A node is reported only if it matches closer than any of its
+// ancestors, whose lists already hold its whole subtree otherwise.
+void SuggestIndex::Find(uint32_t node, size_t depth, size_t ancestor_distance, Search& search) const {
+  const auto& row = search.rows[depth];
+  const size_t distance = row.back();
+  if (distance < ancestor_distance) {
+    Collect(node, distance, search.found);
+    ancestor_distance = distance;
+  }
+  if (*min_element(row.begin(), row.end()) >= ancestor_distance) {
+    return;
+  }
+
+  if (search.rows.size() == depth + 1) {
+    search.rows.emplace_back(row.size());
+  }
+  for (uint32_t child = first_child_[node]; child < first_child_[node + 1]; ++child) {
+    // The reference may move when deeper rows are added
+    const auto& parent = search.rows[depth];
+    auto& next = search.rows[depth + 1];
+    next[0] = depth + 1;
+    for (size_t j = 1; j < next.size(); ++j) {
+      const size_t replace = parent[j - 1] + (search.query[j - 1] != labels_[child]);
+      next[j] = min({parent[j] + 1, next[j - 1] + 1, replace});
+    }
+    Find(child, depth + 1, ancestor_distance, search);
+  }
+}
+
+void SuggestIndex::FindPrefix(const vector<uint32_t>& letters, Found& found) const {
+  uint32_t node = 0;
+  for (uint32_t c : letters) {
+    const auto begin = labels_.begin() + first_child_[node];
+    const auto end = labels_.begin() + first_child_[node + 1];
+    const auto it = lower_bound(begin, end, c);
+    if (it == end || *it != c) {
+      return;
+    }
+    node = it - labels_.begin();
+  }
+  Collect(node, 0, found);
+}
+
+void SuggestIndex::Collect(uint32_t node, size_t distance, Found& found) const {
+  for (uint32_t i = top_offsets_[node]; i < top_offsets_[node + 1]; ++i) {
+    found.emplace_back(top_ids_[i], distance);
+  }
+}
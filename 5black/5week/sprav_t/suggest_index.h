@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "pages.pb.h"
+
+// Completion trie over company names, keyed by lower case code points.
+// Nodes are numbered breadth first, so children of a node are one range
+// of node ids. Every node keeps the best ranked companies of its subtree:
+// a prefix lookup is a walk down plus a copy of one list.
+class SuggestIndex {
+ public:
+  static const size_t MAX_COUNT = 16;
+  static const size_t MAX_DISTANCE = 2;
+
+  struct Entry {
+    std::string_view name;
+    uint32_t company_id;
+  };
+
+  // Company id and the edit distance of the query to a name prefix
+  using Found = std::vector<std::pair<size_t, size_t>>;
+
+  SuggestIndex() = default;
+  // Higher scores come first, scores are indexed by company id
+  SuggestIndex(const std::vector<Entry>& entries, std::vector<uint32_t> scores);
+  SuggestIndex(const SpravSerialize::SuggestIndex& m);
+
+  void Serialize(SpravSerialize::SuggestIndex& m) const;
+
+  // Up to count companies having a name that starts with the query
+  // mistyped in at most max_distance letters. Closer matches come
+  // first, then higher scores.
+  Found Suggest(std::string_view query, size_t count, size_t max_distance) const;
+
+  // Typos allowed by default: none for short queries, where any prefix
+  // would match, more as the query grows
+  static size_t GetDefaultDistance(std::string_view query);
+
+  size_t Size() const;
+  size_t GetMemoryUsage() const;
+
+ private:
+  // Children of node n are nodes [first_child_[n], first_child_[n + 1])
+  std::vector<uint32_t> first_child_;
+  // Code point on the edge into the node
+  std::vector<uint32_t> labels_;
+  // Best companies of the subtree of node n are
+  // top_ids_[top_offsets_[n]..top_offsets_[n + 1]), best first
+  std::vector<uint32_t> top_offsets_;
+  std::vector<uint32_t> top_ids_;
+  std::vector<uint32_t> scores_;
+
+  bool Better(uint32_t lhs, uint32_t rhs) const;
+
+  void FindPrefix(const std::vector<uint32_t>& letters, Found& found) const;
+
+  struct Search;
+  void Find(uint32_t node, size_t depth, size_t ancestor_distance, Search& search) const;
+  void Collect(uint32_t node, size_t distance, Found& found) const;
+};
@@ -1,5 +1,7 @@
 #include "svg.h"
 
+#include "memory_report.h"
+
 using namespace std;
 
 namespace Svg {
@@ -104,10 +106,33 @@ std::ostream& operator<<(std::ostream& s, const Object& o) {
   return s;
 }
 
+size_t Object::GetMemoryUsage() const {
+  size_t size = Memory::GetHeapSize(type_) + Memory::GetHeapSize(options_);
+  if (data_) {
+    size += Memory::GetHeapSize(*data_);
+  }
+  for (const auto& [name, value] : options_) {
+    size += Memory::GetHeapSize(name) + Memory::GetHeapSize(value);
+  }
+  return size;
+}
+
 void Document::Add(Object o) {
   objects_.push_back(move(o));
 }
 
+size_t Document::GetObjectsCount() const {
+  return objects_.size();
+}
+
+size_t Document::GetMemoryUsage() const {
+  size_t size = Memory::GetHeapSize(objects_);
+  for (const auto& o : objects_) {
+    size += o.GetMemoryUsage();
+  }
+  return size;
+}
+
 void Document::Render(std::ostream& s) const {
   s << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>";
   s << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">";
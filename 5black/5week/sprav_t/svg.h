@@ -80,6 +80,8 @@ class Object {
 
   void Render(std::ostream&) const;
 
+  size_t GetMemoryUsage() const;
+
  private:
   std::string type_;
   std::optional<std::string> data_;
@@ -96,6 +98,9 @@ class Document {
   void Add(Object);
   void Render(std::ostream&) const;
 
+  size_t GetObjectsCount() const;
+  size_t GetMemoryUsage() const;
+
  private:
   std::deque<Object> objects_;
 };
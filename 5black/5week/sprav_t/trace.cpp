@@ -0,0 +1,260 @@
+#include "trace.h"
+
+#ifdef SPRAV_TRACE
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using namespace std;
+
+namespace Trace {
+
+namespace {
+
+const size_t BUFFER_CAPACITY = 1 << 16;
+
+uint64_t Now() {
+  static const auto start = chrono::steady_clock::now();
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+// Spans of one thread. Only the owning thread writes; readers come at
+// exit when worker threads are gone.
+class ThreadBuffer {
+ public:
+  explicit ThreadBuffer(uint32_t thread_id)
+    : thread_id_(thread_id)
+  {}
+
+  // Makes a new span the innermost open one, returns its id
+  uint32_t Open() {
+    const uint32_t id = next_id_++;
+    current_id_ = id;
+    return id;
+  }
+
+  uint32_t GetCurrentId() const {
+    return current_id_;
+  }
+
+  void Close(const char* name, uint32_t id, uint32_t parent_id, uint64_t start_ns) {
+    current_id_ = parent_id;
+    Push({name, thread_id_, id, parent_id, start_ns, Now() - start_ns});
+  }
+
+  void AppendTo(vector<Span>& spans) const {
+    spans.insert(spans.end(), spans_.begin() + next_, spans_.end());
+    spans.insert(spans.end(), spans_.begin(), spans_.begin() + next_);
+  }
+
+  size_t GetDropped() const {
+    return dropped_;
+  }
+
+ private:
+  const uint32_t thread_id_;
+  uint32_t next_id_ = 1;
+  uint32_t current_id_ = 0;
+  vector<Span> spans_;
+  size_t next_ = 0;
+  size_t dropped_ = 0;
+
+  void Push(const Span& span) {
+    if (spans_.size() < BUFFER_CAPACITY) {
+      spans_.push_back(span);
+      return;
+    }
+    spans_[next_] = span;
+    next_ = (next_ + 1) % BUFFER_CAPACITY;
+    ++dropped_;
+  }
+};
+
+namespace {
+
+class Collector {
+ public:
+  ThreadBuffer& AddThread() {
+    lock_guard g(m_);
+    buffers_.push_back(make_unique<ThreadBuffer>(buffers_.size()));
+    return *buffers_.back();
+  }
+
+  vector<Span> GetSpans(size_t& dropped) const {
+    lock_guard g(m_);
+    vector<Span> spans;
+    dropped = 0;
+    for (const auto& buffer : buffers_) {
+      buffer->AppendTo(spans);
+      dropped += buffer->GetDropped();
+    }
+    return spans;
+  }
+
+ private:
+  mutable mutex m_;
+  vector<unique_ptr<ThreadBuffer>> buffers_;
+};
+
+// Never destroyed: spans may be recorded during static destruction
+Collector& GetCollector() {
+  static Collector* collector = new Collector;
+  return *collector;
+}
+
+ThreadBuffer& GetThreadBuffer() {
+  thread_local ThreadBuffer* buffer = &GetCollector().AddThread();
+  return *buffer;
+}
+
+void PrintEscaped(ostream& os, string_view s) {
+  os << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      os << '\\';
+    }
+    os << c;
+  }
+  os << '"';
+}
+
+void ExportChrome(ostream& os, const vector<Span>& spans) {
+  os << "{\"traceEvents\":[";
+  bool first = true;
+  for (const auto& span : spans) {
+    os << (first ? "" : ",") << "\n{\"name\":";
+    first = false;
+    PrintEscaped(os, span.name);
+    os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.thread_id
+       << ",\"ts\":" << span.start_ns / 1000.0
+       << ",\"dur\":" << span.duration_ns / 1000.0 << "}";
+  }
+  os << "\n]}\n";
+}
+
+// One row per nesting path, rows in order of the first start
+void ExportSummary(ostream& os, const vector<Span>& spans) {
+  using SpanKey = pair<uint32_t, uint32_t>;
+  map<SpanKey, const Span*> by_id;
+  for (const auto& span : spans) {
+    by_id[{span.thread_id, span.id}] = &span;
+  }
+
+  map<SpanKey, string> paths;
+  auto get_path = [&](const Span& span, auto& self) -> const string& {
+    const SpanKey key{span.thread_id, span.id};
+    if (auto it = paths.find(key); it != paths.end()) {
+      return it->second;
+    }
+    string path;
+    if (auto it = by_id.find({span.thread_id, span.parent_id}); span.parent_id && it != by_id.end()) {
+      path = self(*it->second, self) + "/";
+    }
+    return paths[key] = path + span.name;
+  };
+
+  struct Stats {
+    uint64_t first_start_ns = 0;
+    size_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+  };
+  unordered_map<string, Stats> stats;
+  for (const auto& span : spans) {
+    auto [it, inserted] = stats.try_emplace(get_path(span, get_path));
+    auto& s = it->second;
+    if (inserted || span.start_ns < s.first_start_ns) {
+      s.first_start_ns = span.start_ns;
+    }
+    s.count += 1;
+    s.total_ns += span.duration_ns;
+    s.max_ns = max(s.max_ns, span.duration_ns);
+  }
+
+  vector<pair<const string*, const Stats*>> rows;
+  rows.reserve(stats.size());
+  for (const auto& [path, s] : stats) {
+    rows.emplace_back(&path, &s);
+  }
+  sort(rows.begin(), rows.end(), [](const auto& lhs, const auto& rhs) {
+    return lhs.second->first_start_ns < rhs.second->first_start_ns;
+  });
+
+  os << "path,count,total_ms,mean_ms,max_ms\n" << fixed << setprecision(3);
+  for (const auto& [path, s] : rows) {
+    PrintEscaped(os, *path);
+    os << "," << s->count
+       << "," << s->total_ns / 1e6
+       << "," << s->total_ns / 1e6 / s->count
+       << "," << s->max_ns / 1e6 << "\n";
+  }
+}
+
+size_t initializers_count = 0;
+
+} // namespace
+
+Scope::Scope(const char* name)
+  : buffer_(GetThreadBuffer())
+  , name_(name)
+  , parent_id_(buffer_.GetCurrentId())
+{
+  id_ = buffer_.Open();
+  start_ns_ = Now();
+}
+
+Scope::~Scope() {
+  buffer_.Close(name_, id_, parent_id_, start_ns_);
+}
+
+vector<Span> GetSpans() {
+  size_t dropped;
+  return GetCollector().GetSpans(dropped);
+}
+
+void Export() {
+  size_t dropped;
+  const auto spans = GetCollector().GetSpans(dropped);
+  if (dropped > 0) {
+    cerr << "Trace: " << dropped << " oldest spans dropped" << endl;
+  }
+
+  const char* file = getenv("SPRAV_TRACE_FILE");
+  if (!file) {
+    ExportSummary(cerr, spans);
+    return;
+  }
+
+  ofstream os(file);
+  if (string_view(file).size() >= 5 && string_view(file).substr(string_view(file).size() - 5) == ".json") {
+    ExportChrome(os, spans);
+  } else {
+    ExportSummary(os, spans);
+  }
+}
+
+Initializer::Initializer() {
+  ++initializers_count;
+}
+
+Initializer::~Initializer() {
+  if (--initializers_count == 0) {
+    Export();
+  }
+}
+
+}
+
+#endif
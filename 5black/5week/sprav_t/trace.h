@@ -0,0 +1,68 @@
+#pragma once
+
+#include "macro.h"
+
+#ifdef SPRAV_TRACE
+
+#include <cstdint>
+#include <vector>
+
+namespace Trace {
+
+struct Span {
+  const char* name;
+  uint32_t thread_id;
+  uint32_t id;
+  uint32_t parent_id;  // 0 for top level spans of the thread
+  uint64_t start_ns;
+  uint64_t duration_ns;
+};
+
+class ThreadBuffer;
+
+// Records a span covering its lifetime into the ring buffer of the
+// current thread. The name must outlive the collector: use literals.
+class Scope {
+ public:
+  explicit Scope(const char* name);
+  ~Scope();
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+ private:
+  ThreadBuffer& buffer_;
+  const char* name_;
+  uint32_t id_;
+  uint32_t parent_id_;
+  uint64_t start_ns_;
+};
+
+// Finished spans of all threads, oldest first within each thread
+std::vector<Span> GetSpans();
+
+// Writes spans where SPRAV_TRACE_FILE points to: Chrome trace-event
+// JSON for *.json, flat CSV summary otherwise. Without the variable the
+// summary goes to stderr.
+void Export();
+
+// Nifty counter: every translation unit including this header holds one,
+// so the collector is exported only after all statics that may trace in
+// their destructors are gone.
+class Initializer {
+ public:
+  Initializer();
+  ~Initializer();
+};
+static Initializer initializer;
+
+}
+
+#define TRACE(name) \
+  Trace::Scope UNIQ_ID(__LINE__){name};
+
+#else
+
+#define TRACE(name)
+
+#endif
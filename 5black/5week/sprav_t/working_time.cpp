@@ -4,6 +4,8 @@
 #include <tuple>
 #include <algorithm>
 
+#include "memory_report.h"
+
 using namespace std;;
 
 Time Time::From(const Json::Node& m) {
@@ -95,6 +97,10 @@ void WorkingTime::Serialize(SpravSerialize::WorkingTime& m) {
   }
 }
 
+size_t WorkingTime::GetMemoryUsage() const {
+  return Memory::GetHeapSize(intervals_);
+}
+
 std::optional<double> WorkingTime::GetWaitTime(const Time& current_time) const {
   if (intervals_.empty()) {
     return {};
@@ -40,6 +40,8 @@ class WorkingTime {
 
   std::optional<double> GetWaitTime(const Time& current_time) const;
 
+  size_t GetMemoryUsage() const;
+
  private:
   std::vector<Time> intervals_;
 };
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "axis_index.h"
+
+using namespace std;
+
+optional<int> AxisIndex::FindId(int index) const {
+  int id = root_;
+  int shift = 0;
+  while (id != NONE) {
+    const auto& node = nodes_[id];
+    const int node_index = node.index + shift;
+    if (node_index == index) {
+      return id;
+    }
+    shift += node.shift;
+    id = index < node_index ? node.left : node.right;
+  }
+  return nullopt;
+}
+
+int AxisIndex::GetIndex(int id) const {
+  int index = nodes_[id].index;
+  for (int parent = nodes_[id].parent; parent != NONE; parent = nodes_[parent].parent) {
+    index += nodes_[parent].shift;
+  }
+  return index;
+}
+
+vector<int> AxisIndex::GetIds(int first, int count) const {
+  vector<int> ids;
+  CollectIds(root_, 0, first, first + count, ids);
+  return ids;
+}
+
+int AxisIndex::GetSize() const {
+  int size = 0;
+  int shift = 0;
+  for (int id = root_; id != NONE; id = nodes_[id].right) {
+    size = nodes_[id].index + shift + 1;
+    shift += nodes_[id].shift;
+  }
+  return size;
+}
+
+int AxisIndex::GetPrintableSize() const {
+  int id = root_;
+  int shift = 0;
+  while (id != NONE) {
+    const auto& node = nodes_[id];
+    if (node.right != NONE && nodes_[node.right].printable_sum > 0) {
+      id = node.right;
+    } else if (node.printable > 0) {
+      return node.index + shift + 1;
+    } else {
+      id = node.left;
+    }
+    shift += node.shift;
+  }
+  return 0;
+}
+
+int AxisIndex::Acquire(int index) {
+  auto id = FindId(index);
+  if (!id) {
+    if (free_ids_.empty()) {
+      id = static_cast<int>(nodes_.size());
+      nodes_.emplace_back();
+    } else {
+      id = free_ids_.back();
+      free_ids_.pop_back();
+    }
+    nodes_[*id] = Node{index, 0, static_cast<uint32_t>(random_())};
+
+    auto [lhs, rhs] = Split(root_, index);
+    SetRoot(Merge(Merge(lhs, *id), rhs));
+  }
+
+  ++nodes_[*id].uses;
+  return *id;
+}
+
+void AxisIndex::Release(int id) {
+  if (--nodes_[id].uses == 0) {
+    Remove(id);
+    free_ids_.push_back(id);
+  }
+}
+
+void AxisIndex::AddPrintable(int id, int delta) {
+  nodes_[id].printable += delta;
+  for (; id != NONE; id = nodes_[id].parent) {
+    nodes_[id].printable_sum += delta;
+  }
+}
+
+void AxisIndex::Insert(int before, int count) {
+  Shift(before, count);
+}
+
+void AxisIndex::Erase(int first, int count) {
+  Shift(first + count, -count);
+}
+
+// Only the nodes on one path and the right subtrees hanging off it
+// are touched, the subtrees keep the shift pending
+void AxisIndex::Shift(int from, int delta) {
+  int id = root_;
+  int shift = 0;
+  while (id != NONE) {
+    auto& node = nodes_[id];
+    const bool shifted = node.index + shift >= from;
+    shift += node.shift;
+    if (shifted) {
+      node.index += delta;
+      if (node.right != NONE) {
+        nodes_[node.right].index += delta;
+        nodes_[node.right].shift += delta;
+      }
+      id = node.left;
+    } else {
+      id = node.right;
+    }
+  }
+}
+
+void AxisIndex::Remove(int id) {
+  // The shifts pending above must reach the node before it is unlinked
+  vector<int> ancestors;
+  for (int parent = nodes_[id].parent; parent != NONE; parent = nodes_[parent].parent) {
+    ancestors.push_back(parent);
+  }
+  for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it) {
+    Push(*it);
+  }
+  Push(id);
+
+  const int parent = nodes_[id].parent;
+  const int child = Merge(nodes_[id].left, nodes_[id].right);
+  if (parent == NONE) {
+    SetRoot(child);
+  } else if (nodes_[parent].left == id) {
+    SetLeft(parent, child);
+  } else {
+    SetRight(parent, child);
+  }
+}
+
+void AxisIndex::Push(int id) {
+  auto& node = nodes_[id];
+  if (node.shift == 0) {
+    return;
+  }
+  for (int child : {node.left, node.right}) {
+    if (child != NONE) {
+      nodes_[child].index += node.shift;
+      nodes_[child].shift += node.shift;
+    }
+  }
+  node.shift = 0;
+}
+
+void AxisIndex::Update(int id) {
+  auto& node = nodes_[id];
+  node.printable_sum = node.printable;
+  for (int child : {node.left, node.right}) {
+    if (child != NONE) {
+      node.printable_sum += nodes_[child].printable_sum;
+    }
+  }
+}
+
+void AxisIndex::SetLeft(int id, int child) {
+  nodes_[id].left = child;
+  if (child != NONE) {
+    nodes_[child].parent = id;
+  }
+  Update(id);
+}
+
+void AxisIndex::SetRight(int id, int child) {
+  nodes_[id].right = child;
+  if (child != NONE) {
+    nodes_[child].parent = id;
+  }
+  Update(id);
+}
+
+void AxisIndex::SetRoot(int id) {
+  root_ = id;
+  if (id != NONE) {
+    nodes_[id].parent = NONE;
+  }
+}
+
+// The parents of the returned roots are left for the caller to set
+pair<int, int> AxisIndex::Split(int id, int index) {
+  if (id == NONE) {
+    return {NONE, NONE};
+  }
+
+  Push(id);
+  if (nodes_[id].index < index) {
+    auto [lhs, rhs] = Split(nodes_[id].right, index);
+    SetRight(id, lhs);
+    return {id, rhs};
+  }
+  auto [lhs, rhs] = Split(nodes_[id].left, index);
+  SetLeft(id, rhs);
+  return {lhs, id};
+}
+
+int AxisIndex::Merge(int lhs, int rhs) {
+  if (lhs == NONE) {
+    return rhs;
+  }
+  if (rhs == NONE) {
+    return lhs;
+  }
+
+  if (nodes_[lhs].priority > nodes_[rhs].priority) {
+    Push(lhs);
+    SetRight(lhs, Merge(nodes_[lhs].right, rhs));
+    return lhs;
+  }
+  Push(rhs);
+  SetLeft(rhs, Merge(lhs, nodes_[rhs].left));
+  return rhs;
+}
+
+void AxisIndex::CollectIds(int id, int shift, int first, int last, vector<int>& ids) const {
+  if (id == NONE) {
+    return;
+  }
+
+  const auto& node = nodes_[id];
+  const int index = node.index + shift;
+  if (index > first) {
+    CollectIds(node.left, shift + node.shift, first, last, ids);
+  }
+  if (first <= index && index < last) {
+    ids.push_back(id);
+  }
+  if (index < last - 1) {
+    CollectIds(node.right, shift + node.shift, first, last, ids);
+  }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Order of the rows or the columns of a sheet. Every index in use is
+// given a stable id, and cells and formulas are linked by ids, so
+// inserting or deleting lines only shifts the indices here. The ids are
+// kept in a treap ordered by index, where a shift of a whole subtree is
+// left pending at its root. An id lives while something uses it, freed
+// ids are given out again.
+class AxisIndex {
+ public:
+  std::optional<int> FindId(int index) const; // O(log(N))
+  int GetIndex(int id) const; // O(log(N))
+  // Ids of the indices in [first, first + count), ordered by index
+  std::vector<int> GetIds(int first, int count) const; // O(log(N)+M)
+  // Highest index in use plus one
+  int GetSize() const; // O(log(N))
+  // Highest index with printable cells plus one
+  int GetPrintableSize() const; // O(log(N))
+
+  // Id of the index, created if needed, with one more use
+  int Acquire(int index); // O(log(N))
+  void Release(int id); // O(log(N))
+  // Counts the cells with text on the line, it must be zero on release
+  void AddPrintable(int id, int delta); // O(log(N))
+
+  void Insert(int before, int count); // O(log(N))
+  // The lines must have no ids left
+  void Erase(int first, int count); // O(log(N))
+
+ private:
+  static constexpr int NONE = -1;
+
+  struct Node {
+    // Exact once the shifts of the ancestors are applied
+    int index = 0;
+    // Pending for the descendants
+    int shift = 0;
+    uint32_t priority = 0;
+    int left = NONE;
+    int right = NONE;
+    int parent = NONE;
+    int uses = 0;
+    int printable = 0;
+    // Of the subtree
+    int printable_sum = 0;
+  };
+
+  // By id
+  std::vector<Node> nodes_;
+  std::vector<int> free_ids_;
+  int root_ = NONE;
+  std::mt19937 random_;
+
+  void Shift(int from, int delta);
+  void Remove(int id);
+  void Push(int id);
+  void Update(int id);
+  void SetLeft(int id, int child);
+  void SetRight(int id, int child);
+  void SetRoot(int id);
+  // Into the ids with indices below the given one and the rest
+  std::pair<int, int> Split(int id, int index);
+  int Merge(int lhs, int rhs);
+  void CollectIds(int id, int shift, int first, int last, std::vector<int>& ids) const;
+};
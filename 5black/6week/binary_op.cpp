@@ -3,8 +3,6 @@
 #include <cmath>
 #include <ostream>
 
-#include "formula_node_full.h"
-
 using namespace std;
 
 IFormula::Value BinaryOp::operator()(double lhs, double rhs) const {
@@ -28,71 +26,22 @@ IFormula::Value BinaryOp::operator()(double lhs, double rhs) const {
   }
 }
 
-ostream& operator<<(ostream& o, const BinaryOp& op) {
-  bool l = false;
-  bool r = false;
-
-  if (op.op == '-') {
-    if (holds_alternative<BinaryOp>(*op.rhs.get())) {
-      char rhs_op = get<BinaryOp>(*op.rhs.get()).op;      
-      if (rhs_op == '+' || rhs_op == '-') {
-        r = true;
-      }
-    }
-  }
-
-  if (op.op == '*') {
-    if (holds_alternative<BinaryOp>(*op.lhs.get())) {
-      char lhs_op = get<BinaryOp>(*op.lhs.get()).op;      
-      if (lhs_op == '+' || lhs_op == '-') {
-        l = true;
-      }
-    }
-    if (holds_alternative<BinaryOp>(*op.rhs.get())) {
-      char rhs_op = get<BinaryOp>(*op.rhs.get()).op;      
-      if (rhs_op == '+' || rhs_op == '-') {
-        r = true;
-      }
-    }
-  }
-
-  if (op.op == '/') {
-    if (holds_alternative<BinaryOp>(*op.lhs.get())) {
-      char lhs_op = get<BinaryOp>(*op.lhs.get()).op;      
-      if (lhs_op == '+' || lhs_op == '-') {
-        l = true;
-      }
-    }
-
-    if (holds_alternative<BinaryOp>(*op.rhs.get())) {
-      r = true;
-    }
-  }
-
-  return o
-    << (l ? "(" : "") << *op.lhs.get() << (l ? ")" : "")
-    << op.op
-    << (r ? "(" : "") << *op.rhs.get() << (r ? ")" : "");
+bool BinaryOp::NeedsLhsParens(char lhs_op) const {
+  const bool lhs_additive = lhs_op == '+' || lhs_op == '-';
+  return (op == '*' || op == '/') && lhs_additive;
 }
 
-IFormula::Value EvaluateNode(const BinaryOp& op, const ISheet& sheet) {
-  double lhs;
-  {
-    auto res = EvaluateNode(*op.lhs.get(), sheet);
-    if (holds_alternative<FormulaError>(res)) {
-      return res;
-    }
-    lhs = get<double>(res);
+bool BinaryOp::NeedsRhsParens(char rhs_op) const {
+  const bool rhs_additive = rhs_op == '+' || rhs_op == '-';
+  if (op == '-' || op == '*') {
+    return rhs_additive;
   }
-
-  double rhs;
-  {
-    auto res = EvaluateNode(*op.rhs.get(), sheet);
-    if (holds_alternative<FormulaError>(res)) {
-      return res;
-    }
-    rhs = get<double>(res);
+  if (op == '/') {
+    return rhs_op != 0;
   }
+  return false;
+}
 
-  return op(lhs, rhs);
+ostream& operator<<(ostream& o, const BinaryOp& op) {
+  return o << op.op;
 }
@@ -1,19 +1,19 @@
 #pragma once
 
-#include <memory>
 #include <ostream>
 
 #include "formula.h"
-#include "formula_node_part.h"
 
+// Operands are the two formula nodes before the operator
 struct BinaryOp {
   char op;
-  std::unique_ptr<FormulaNode> lhs;
-  std::unique_ptr<FormulaNode> rhs;
 
   IFormula::Value operator()(double lhs, double rhs) const;
+
+  // Whether an operand is printed in parentheses, given the operator at
+  // the root of the operand, 0 for none
+  bool NeedsLhsParens(char lhs_op) const;
+  bool NeedsRhsParens(char rhs_op) const;
 };
 
 std::ostream& operator<<(std::ostream& o, const BinaryOp& op);
-
-IFormula::Value EvaluateNode(const BinaryOp& op, const ISheet& sheet);
\ No newline at end of file
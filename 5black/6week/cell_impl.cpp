@@ -62,13 +62,17 @@ bool Cell::IsFree() const {
   return refs_from_.empty();
 }
 
+bool Cell::HasText() const {
+  return !text_.empty();
+}
+
 void Cell::SetText(std::string text) {
   METER_DURATION(sheet_.m_cell_set);
   if (text == text_) {
     return;
   }
 
-  unique_ptr<IFormula> new_formula;
+  unique_ptr<Formula> new_formula;
   if (text.size() > 1 && text[0] == kFormulaSign) {
     METER_DURATION(sheet_.m_cell_set_formula_parsing);
     string_view view = text;
@@ -77,40 +81,21 @@ void Cell::SetText(std::string text) {
   }
 
   ProcessRefs(new_formula.get());
+  if (new_formula) {
+    new_formula->BindToSheet(sheet_);
+  }
 
   formula_ = std::move(new_formula);
   text_ = std::move(text);
   InvalidateCache();
 }
 
-void Cell::PrepareToDelete() {
+void Cell::PrepareToDelete(Position key) {
   SetText("");
   for (auto ref : refs_from_) {
     ref->refs_to_.erase(this);
-  }
-}
-
-void Cell::HandleInsertedRows(int before, int count) {
-  if (formula_) {
-    formula_->HandleInsertedRows(before, count);
-  }
-}
-
-void Cell::HandleInsertedCols(int before, int count) {
-  if (formula_) {
-    formula_->HandleInsertedCols(before, count);
-  }
-}
-
-void Cell::HandleDeletedRows(int first, int count) {
-  if (formula_) {
-    formula_->HandleDeletedRows(first, count);
-  }
-}
-
-void Cell::HandleDeletedCols(int first, int count) {
-  if (formula_) {
-    formula_->HandleDeletedCols(first, count);
+    ref->formula_->HandleDeletedCell(key);
+    ref->InvalidateCache();
   }
 }
 
@@ -5,6 +5,7 @@
 #include <unordered_set>
 
 #include "common_etc.h"
+#include "formula_impl.h"
 
 class Sheet;
 
@@ -19,14 +20,10 @@ class Cell : public ICell {
 
   std::vector<Position> GetReferencedCells() const override; // O(1)
   bool IsFree() const; // O(1)
+  bool HasText() const; // O(1)
   void SetText(std::string text); // O(K*R), O(1)
-  void PrepareToDelete(); // O(K*R)
-
-  void HandleInsertedRows(int before, int count = 1);
-  void HandleInsertedCols(int before, int count = 1);
-
-  void HandleDeletedRows(int first, int count = 1);
-  void HandleDeletedCols(int first, int count = 1);
+  // Formulas referencing the cell by the key get the ref error
+  void PrepareToDelete(Position key); // O(K*R)
 
  private:
   Sheet& sheet_;
@@ -35,7 +32,7 @@ class Cell : public ICell {
   size_t cc_epoch_ = 0;
 
   std::string text_;
-  std::unique_ptr<IFormula> formula_;
+  std::unique_ptr<Formula> formula_;
 
   mutable std::optional<Value> value_;
 
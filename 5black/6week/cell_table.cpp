@@ -0,0 +1,75 @@
+#include "cell_table.h"
+
+using namespace std;
+
+Cell* CellTable::Find(Position pos) const {
+  auto it = tiles_.find(GetTileKey(pos));
+  if (it == tiles_.end()) {
+    return nullptr;
+  }
+
+  auto& slot = it->second->cells[GetSlot(pos)];
+  return slot ? &*slot : nullptr;
+}
+
+Cell& CellTable::Insert(Position pos, Sheet& sheet) {
+  auto& tile = tiles_[GetTileKey(pos)];
+  if (!tile) {
+    tile = make_unique<Tile>();
+  }
+
+  const size_t slot = GetSlot(pos);
+  if (!tile->cells[slot]) {
+    tile->cells[slot].emplace(sheet);
+    tile->occupied |= uint64_t(1) << slot;
+    ++size_;
+  }
+  return *tile->cells[slot];
+}
+
+void CellTable::Erase(Position pos) {
+  auto it = tiles_.find(GetTileKey(pos));
+  if (it == tiles_.end()) {
+    return;
+  }
+
+  auto& tile = *it->second;
+  const size_t slot = GetSlot(pos);
+  if (!tile.cells[slot]) {
+    return;
+  }
+  tile.cells[slot].reset();
+  --size_;
+  tile.occupied &= ~(uint64_t(1) << slot);
+  if (tile.occupied == 0) {
+    tiles_.erase(it);
+  }
+}
+
+size_t CellTable::GetSize() const {
+  return size_;
+}
+
+void CellTable::ForEach(const function<void(Position, Cell&)>& f) const {
+  for (const auto& [key, tile] : tiles_) {
+    const Position origin = {
+      static_cast<int>(key >> 32) << TILE_BITS,
+      static_cast<int>(key & 0xFFFFFFFF) << TILE_BITS,
+    };
+    size_t slot = 0;
+    for (uint64_t rest = tile->occupied; rest != 0; rest >>= 1, ++slot) {
+      if (rest & 1) {
+        f({origin.row + static_cast<int>(slot / TILE_SIDE), origin.col + static_cast<int>(slot % TILE_SIDE)},
+          *tile->cells[slot]);
+      }
+    }
+  }
+}
+
+uint64_t CellTable::GetTileKey(Position pos) {
+  return uint64_t(pos.row >> TILE_BITS) << 32 | uint32_t(pos.col >> TILE_BITS);
+}
+
+size_t CellTable::GetSlot(Position pos) {
+  return (pos.row % TILE_SIDE) * TILE_SIDE + pos.col % TILE_SIDE;
+}
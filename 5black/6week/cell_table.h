@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+#include "cell_impl.h"
+#include "common_etc.h"
+
+// Sparse storage of cells in square tiles allocated on demand, so memory
+// follows the cells and not the sheet bounds. Cells live in tiles by
+// value and never move, as dependencies link them by address. An
+// occupancy bitmap per tile lets iteration skip empty slots.
+class CellTable {
+ public:
+  Cell* Find(Position pos) const; // O(1)
+  Cell& Insert(Position pos, Sheet& sheet); // O(1)
+  void Erase(Position pos); // O(1)
+  size_t GetSize() const; // O(1)
+
+  // f must not insert cells
+  void ForEach(const std::function<void(Position, Cell&)>& f) const; // O(K)
+
+ private:
+  static const int TILE_BITS = 3;
+  static const int TILE_SIDE = 1 << TILE_BITS;
+
+  struct Tile {
+    // Bit i is set if cells[i] holds a cell
+    uint64_t occupied = 0;
+    std::array<std::optional<Cell>, TILE_SIDE * TILE_SIDE> cells;
+  };
+  static_assert(TILE_SIDE * TILE_SIDE <= 64, "occupancy bitmap is one word");
+
+  std::unordered_map<uint64_t, std::unique_ptr<Tile>> tiles_;
+  size_t size_ = 0;
+
+  static uint64_t GetTileKey(Position pos);
+  static size_t GetSlot(Position pos);
+};
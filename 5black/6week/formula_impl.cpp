@@ -1,7 +1,9 @@
 #include "formula_impl.h"
 
+#include <algorithm>
 #include <sstream>
-#include <queue>
+
+#include "sheet_impl.h"
 
 using namespace std;
 
@@ -57,22 +59,71 @@ void Formula::SetReferencedCells(vector<Position> refs) {
   referenced_cells_ = std::move(refs);
 }
 
-void Formula::SetRootNode(FormulaNode root) {
-  root_ = std::move(root);
+void Formula::SetProgram(FormulaProgram program) {
+  program_ = std::move(program);
+}
+
+void Formula::BindToSheet(const Sheet& sheet) {
+  sheet_ = &sheet;
+  for (auto& pos : referenced_cells_) {
+    pos = sheet.GetKey(pos);
+  }
+  for (auto& node : program_) {
+    if (auto* pos = get_if<Position>(&node)) {
+      *pos = sheet.GetKey(*pos);
+    }
+  }
+}
+
+void Formula::HandleDeletedCell(Position key) {
+  referenced_cells_.erase(remove(referenced_cells_.begin(), referenced_cells_.end(), key),
+                          referenced_cells_.end());
+  for (auto& node : program_) {
+    if (auto* pos = get_if<Position>(&node); pos && *pos == key) {
+      node = FormulaError(FormulaError::Category::Ref);
+    }
+  }
 }
 
 IFormula::Value Formula::Evaluate(const ISheet& sheet) const {
-  return EvaluateNode(root_, sheet);
+  if (sheet_) {
+    return program_.Evaluate([this](Position key) {
+      return sheet_->GetCellByKey(key);
+    });
+  }
+  return program_.Evaluate([&sheet](Position pos) {
+    return sheet.GetCell(pos);
+  });
 }
 
 std::string Formula::GetExpression() const {
   ostringstream ss;
-  ss << root_;
+  if (sheet_) {
+    auto program = program_;
+    for (auto& node : program) {
+      if (auto* pos = get_if<Position>(&node)) {
+        *pos = sheet_->GetPosition(*pos);
+      }
+    }
+    ss << program;
+  } else {
+    ss << program_;
+  }
   return ss.str();
 }
 
+// The order of keys is the order of positions, as lines keep their order
 std::vector<Position> Formula::GetReferencedCells() const {
-  return referenced_cells_;
+  if (!sheet_) {
+    return referenced_cells_;
+  }
+
+  vector<Position> refs;
+  refs.reserve(referenced_cells_.size());
+  for (auto key : referenced_cells_) {
+    refs.push_back(sheet_->GetPosition(key));
+  }
+  return refs;
 }
 
 IFormula::HandlingResult Formula::HandleInsertedRows(int before, int count) {
@@ -99,7 +150,11 @@ IFormula::HandlingResult Formula::HandleDeletedCols(int first, int count) {
   });
 }
 
+// A bound formula keeps its keys, the sheet moves the lines
 IFormula::HandlingResult Formula::TraverseChangedCells(CellTraverser f) {
+  if (sheet_) {
+    return HandlingResult::NothingChanged;
+  }
   auto res = TraverseChangedCellsForRefs(f);
   TraverseChangedCellsForFormula(f);
   return res;
@@ -124,30 +179,14 @@ IFormula::HandlingResult Formula::TraverseChangedCellsForRefs(CellTraverser f) {
 }
 
 void Formula::TraverseChangedCellsForFormula(CellTraverser f) {
-  queue<FormulaNode*> q;
-  q.push(&root_);
-
-  while (!q.empty()) {
-    auto node = q.front();
-    q.pop();
-
-    if (!node) {
-      continue;
-    }
-
-    if (holds_alternative<Position>(*node)) {
-      auto [new_pos, res] = f(get<Position>(*node));
+  for (auto& node : program_) {
+    if (holds_alternative<Position>(node)) {
+      auto [new_pos, res] = f(get<Position>(node));
       if (res == HandlingResult::ReferencesRenamedOnly) {
-        *node = new_pos;
+        node = new_pos;
       } else if (res == HandlingResult::ReferencesChanged) {
-        *node = FormulaError(FormulaError::Category::Ref);
+        node = FormulaError(FormulaError::Category::Ref);
       }
-    } else if (holds_alternative<BinaryOp>(*node)) {
-      auto& op = get<BinaryOp>(*node);
-      q.push(op.lhs.get());
-      q.push(op.rhs.get());
-    } else if (holds_alternative<UnaryOp>(*node)) {
-      q.push(get<UnaryOp>(*node).arg.get());
     }
   }
 }
\ No newline at end of file
@@ -6,11 +6,21 @@
 #include "common_etc.h"
 #include "formula_node_full.h"
 
+class Sheet;
+
+// Holds cell positions until it is bound to a sheet, then the keys of
+// the cells, which do not change when lines are inserted or deleted.
+// The positions of a bound formula are found through the sheet.
 class Formula : public IFormula {
  public:
   void SetReferencedCells(std::vector<Position> refs);
 
-  void SetRootNode(FormulaNode root);
+  void SetProgram(FormulaProgram program);
+
+  // The referenced cells must exist in the sheet
+  void BindToSheet(const Sheet& sheet); // O(R*log(N))
+  // Replaces the refs to a cell of the bound sheet with the ref error
+  void HandleDeletedCell(Position key); // O(R)
 
   Value Evaluate(const ISheet& sheet) const override;
 
@@ -26,7 +36,8 @@ class Formula : public IFormula {
 
  private:
   std::vector<Position> referenced_cells_;
-  FormulaNode root_;
+  FormulaProgram program_;
+  const Sheet* sheet_ = nullptr;
 
   using CellTraverser = std::function<std::pair<Position, IFormula::HandlingResult>(Position)>;
 
@@ -1,5 +1,5 @@
 #pragma once
 
-#include "formula_node.h"
+#include "formula_program.h"
 #include "binary_op.h"
 #include "unary_op.h"
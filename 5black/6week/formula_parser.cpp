@@ -1,143 +1,268 @@
-#include <cmath>
-#include <set>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
 #include <sstream>
-#include <stack>
 #include <stdexcept>
+#include <string_view>
 
-#include "FormulaLexer.h"
-#include "FormulaBaseListener.h"
-#include "FormulaParser.h"
-#include "antlr4-runtime.h"
 #include "common_etc.h"
 #include "formula_impl.h"
 #include "formula_node_full.h"
-#include "profile.h"
 #include "sheet_impl.h"
 
 using namespace std;
 
-class BailErrorListener : public antlr4::BaseErrorListener {
- public:
-  void syntaxError(antlr4::Recognizer* /* recognizer */,
-                   antlr4::Token* /* offendingSymbol */, size_t /* line */,
-                   size_t /* charPositionInLine */, const std::string& msg,
-                   std::exception_ptr /* e */
-                   ) override {
-    throw FormulaException("Error when lexing: " + msg);
-  }
-};
+namespace {
 
-class MyFormulaListener : public FormulaBaseListener {
+// Recursive descent over Formula.g4 without a token stream: tokens are
+// read from the text on demand and nodes are pushed in postfix order,
+// as the program is stored, so only the program is allocated. Unary
+// operators bind tighter than binary ones, binary ones are left
+// associative, exactly as ANTLR orders the alternatives of expr.
+// Bad cell refs and literals out of range are found by ANTLR only when
+// walking a complete tree, so they are reported after syntax errors.
+class FormulaReader {
  public:
-  MyFormulaListener(Sheet& sheet)
-    : sheet_(sheet)
+  explicit FormulaReader(string_view text)
+    : text_(text)
   {}
 
-  void exitLiteral(FormulaParser::LiteralContext *ctx) override {
-    METER_DURATION(sheet_.m_fp_walk_lit);
-    memory_.push(stod(ctx->NUMBER()->getSymbol()->getText()));
-  }
-
-  void exitCell(FormulaParser::CellContext *ctx) override {
-    METER_DURATION(sheet_.m_fp_walk_cell);
-    auto pos = Position::FromString(ctx->CELL()->getSymbol()->getText());
+  // main : expr EOF
+  FormulaProgram ReadMain() {
+    ReadExpr(1);
+    SkipSpaces();
+    if (pos_ != text_.size()) {
+      FailParsing("extraneous input");
+    }
 
-    if (!pos.IsValid()) {
+    switch (deferred_error_) {
+    case DeferredError::NONE:
+      break;
+    case DeferredError::WRONG_CELL_REF:
       throw FormulaException("Wrong cell ref");
+    case DeferredError::OUT_OF_RANGE:
+      throw out_of_range("stod");
     }
+    program_.ShrinkToFit();
+    return move(program_);
+  }
 
-    refs_.insert(pos);
-    memory_.push(pos);
+  vector<Position> TakeRefs() {
+    sort(refs_.begin(), refs_.end());
+    refs_.erase(unique(refs_.begin(), refs_.end()), refs_.end());
+    return move(refs_);
   }
 
-  void exitUnaryOp(FormulaParser::UnaryOpContext *ctx) override {
-    METER_DURATION(sheet_.m_fp_walk_op_1);
-    auto arg = std::move(memory_.top());
-    memory_.pop();
-    if (ctx->ADD()) {
-      memory_.push(UnaryOp{'+', make_unique<FormulaNode>(std::move(arg))});
-    } else if (ctx->SUB()) {
-      memory_.push(UnaryOp{'-', make_unique<FormulaNode>(std::move(arg))});
-    }
+ private:
+  string_view text_;
+  size_t pos_ = 0;
+  FormulaProgram program_;
+  vector<Position> refs_;
+
+  enum class DeferredError {
+    NONE,
+    WRONG_CELL_REF,
+    OUT_OF_RANGE,
+  };
+  // The first one in the text, as the tree walk meets them in this order
+  DeferredError deferred_error_ = DeferredError::NONE;
+
+  // Longest literal that is converted without a heap buffer
+  static const size_t MAX_SHORT_LITERAL = 63;
+
+  static bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
   }
 
-  void exitBinaryOp(FormulaParser::BinaryOpContext *ctx) override {
-    METER_DURATION(sheet_.m_fp_walk_op_2);
-    auto rhs = std::move(memory_.top());
-    memory_.pop();
-    auto lhs = std::move(memory_.top());
-    memory_.pop();
+  static bool IsDigit(char c) {
+    return '0' <= c && c <= '9';
+  }
+
+  static bool IsLetter(char c) {
+    return 'A' <= c && c <= 'Z';
+  }
+
+  static int GetPrecedence(char op) {
+    return op == '*' || op == '/' ? 2 : op == '+' || op == '-' ? 1 : 0;
+  }
+
+  bool Has(size_t pos, bool (*pred)(char)) const {
+    return pos < text_.size() && pred(text_[pos]);
+  }
 
-    if (ctx->MUL()) {
-      memory_.push(BinaryOp{'*',
-        make_unique<FormulaNode>(std::move(lhs)),
-        make_unique<FormulaNode>(std::move(rhs))});
-    } else if (ctx->DIV()) {
-      memory_.push(BinaryOp{'/',
-        make_unique<FormulaNode>(std::move(lhs)),
-        make_unique<FormulaNode>(std::move(rhs))});
-    } else if (ctx->ADD()) {
-      memory_.push(BinaryOp{'+',
-        make_unique<FormulaNode>(std::move(lhs)),
-        make_unique<FormulaNode>(std::move(rhs))});
-    } else if (ctx->SUB()) {
-      memory_.push(BinaryOp{'-',
-        make_unique<FormulaNode>(std::move(lhs)),
-        make_unique<FormulaNode>(std::move(rhs))});
+  void SkipSpaces() {
+    while (Has(pos_, IsSpace)) {
+      ++pos_;
     }
   }
 
-  unique_ptr<IFormula> FlushResult() {
-    METER_DURATION(sheet_.m_fp_walk_flush);
-    auto formula = make_unique<Formula>();
+  void Defer(DeferredError error) {
+    if (deferred_error_ == DeferredError::NONE) {
+      deferred_error_ = error;
+    }
+  }
 
-    vector<Position> refs(refs_.begin(), refs_.end());
-    formula->SetReferencedCells(std::move(refs));
-    formula->SetRootNode(std::move(memory_.top()));
-    return formula;
+  [[noreturn]] void FailParsing(string_view what) const {
+    ostringstream ss;
+    ss << "Error when parsing: " << what << " at " << pos_;
+    throw FormulaException(ss.str());
   }
 
- private:
-  Sheet &sheet_;
-  set<Position> refs_;
-  stack<FormulaNode> memory_;
-};
+  [[noreturn]] void FailLexing() const {
+    ostringstream ss;
+    ss << "Error when lexing: token recognition error at " << pos_;
+    throw FormulaException(ss.str());
+  }
 
-std::unique_ptr<IFormula> ParseFormula(std::string expression, Sheet& sheet) {
-  istringstream ss(expression);
-  antlr4::ANTLRInputStream input(ss);
+  void ReadExpr(int min_precedence) {
+    ReadUnary();
+    for (;;) {
+      SkipSpaces();
+      if (pos_ == text_.size()) {
+        return;
+      }
+      const char op = text_[pos_];
+      const int precedence = GetPrecedence(op);
+      if (precedence == 0 || precedence < min_precedence) {
+        return;
+      }
+      ++pos_;
+      ReadExpr(precedence + 1);
+      program_.PushBinaryOp(op);
+    }
+  }
 
-  FormulaLexer lexer(&input);
-  BailErrorListener error_listener;
-  lexer.removeErrorListeners();
-  lexer.addErrorListener(&error_listener);
+  // '(' expr ')' | (ADD | SUB) expr | CELL | NUMBER
+  void ReadUnary() {
+    SkipSpaces();
+    if (pos_ == text_.size()) {
+      FailParsing("unexpected end of input");
+    }
 
-  antlr4::CommonTokenStream tokens(&lexer);
+    const char c = text_[pos_];
+    if (c == '+' || c == '-') {
+      ++pos_;
+      ReadUnary();
+      program_.PushUnaryOp(c);
+      return;
+    }
+    if (c == '(') {
+      ++pos_;
+      ReadExpr(1);
+      SkipSpaces();
+      if (pos_ == text_.size() || text_[pos_] != ')') {
+        FailParsing("missing ')'");
+      }
+      ++pos_;
+      return;
+    }
+    if (IsLetter(c)) {
+      ReadCell();
+      return;
+    }
+    if (IsDigit(c) || c == '.') {
+      ReadNumber();
+      return;
+    }
+    if (c == ')' || c == '*' || c == '/') {
+      FailParsing("unexpected operator");
+    }
+    FailLexing();
+  }
 
-  FormulaParser parser(&tokens);
-  auto error_handler = std::make_shared<antlr4::BailErrorStrategy>();
-  parser.setErrorHandler(error_handler);
-  parser.removeErrorListeners();
+  // CELL : [A-Z]+[0-9]+. Saturates instead of overflowing, the limits
+  // are far below INT_MAX anyway.
+  void ReadCell() {
+    // Just beyond the limits, in locals: std::min takes references
+    const int max_col = Position::kMaxCols;
+    const int max_row = Position::kMaxRows + 1;
+    Position pos = {0, -1};
+    while (Has(pos_, IsLetter)) {
+      pos.col = min(text_[pos_++] - 'A' + (pos.col + 1) * 26, max_col);
+    }
+    if (!Has(pos_, IsDigit)) {
+      FailLexing();
+    }
+    while (Has(pos_, IsDigit)) {
+      pos.row = min(text_[pos_++] - '0' + pos.row * 10, max_row);
+    }
+    pos.row -= 1;
 
-  antlr4::tree::ParseTree* tree = nullptr;
-  {
-    METER_DURATION(sheet.m_fp_get_tree);
-    try {
-      tree = parser.main();
-    } catch (std::exception &e) {
-      ostringstream ess;
-      ess << "Error when parsing: " << e.what();
-      throw FormulaException(ess.str());
+    if (!pos.IsValid()) {
+      Defer(DeferredError::WRONG_CELL_REF);
+    } else {
+      refs_.push_back(pos);
     }
+    program_.PushLeaf(pos);
   }
 
-  MyFormulaListener listener(sheet);
-  {
-    METER_DURATION(sheet.m_fp_walk);
-    antlr4::tree::ParseTreeWalker::DEFAULT.walk(&listener, tree);
+  // NUMBER : UINT EXPONENT? | UINT? '.' UINT EXPONENT?
+  // An incomplete fraction or exponent is left to the next token, as the
+  // ANTLR lexer falls back to its last complete match.
+  void ReadNumber() {
+    const size_t begin = pos_;
+    size_t end = pos_;
+    while (Has(end, IsDigit)) {
+      ++end;
+    }
+    if (end < text_.size() && text_[end] == '.' && Has(end + 1, IsDigit)) {
+      end += 2;
+      while (Has(end, IsDigit)) {
+        ++end;
+      }
+    }
+    if (end == begin) {
+      FailLexing();
+    }
+    if (end < text_.size() && (text_[end] == 'e' || text_[end] == 'E')) {
+      size_t exponent = end + 1;
+      if (exponent < text_.size() && (text_[exponent] == '+' || text_[exponent] == '-')) {
+        ++exponent;
+      }
+      if (Has(exponent, IsDigit)) {
+        end = exponent;
+        while (Has(end, IsDigit)) {
+          ++end;
+        }
+      }
+    }
+    pos_ = end;
+    program_.PushLeaf(ToDouble(text_.substr(begin, end - begin)));
+  }
+
+  // Same conversion as stod, with the literal copied to a stack buffer
+  // to terminate it
+  double ToDouble(string_view literal) {
+    char short_buffer[MAX_SHORT_LITERAL + 1];
+    string long_buffer;
+    const char* str = short_buffer;
+    if (literal.size() <= MAX_SHORT_LITERAL) {
+      literal.copy(short_buffer, literal.size());
+      short_buffer[literal.size()] = '\0';
+    } else {
+      long_buffer = string(literal);
+      str = long_buffer.c_str();
+    }
+
+    errno = 0;
+    const double value = strtod(str, nullptr);
+    if (errno == ERANGE) {
+      Defer(DeferredError::OUT_OF_RANGE);
+    }
+    return value;
   }
+};
+
+}
+
+std::unique_ptr<Formula> ParseFormula(std::string expression, Sheet& sheet) {
+  FormulaReader reader(expression);
+  auto program = reader.ReadMain();
 
-  return listener.FlushResult();
+  auto formula = make_unique<Formula>();
+  formula->SetReferencedCells(reader.TakeRefs());
+  formula->SetProgram(std::move(program));
+  return formula;
 }
 
 unique_ptr<IFormula> ParseFormula(string expression) {
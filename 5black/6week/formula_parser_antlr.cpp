@@ -0,0 +1,110 @@
+#include <cmath>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include "FormulaLexer.h"
+#include "FormulaBaseListener.h"
+#include "FormulaParser.h"
+#include "antlr4-runtime.h"
+#include "common_etc.h"
+#include "formula_impl.h"
+#include "formula_node_full.h"
+#include "sheet_impl.h"
+
+using namespace std;
+
+class BailErrorListener : public antlr4::BaseErrorListener {
+ public:
+  void syntaxError(antlr4::Recognizer* /* recognizer */,
+                   antlr4::Token* /* offendingSymbol */, size_t /* line */,
+                   size_t /* charPositionInLine */, const std::string& msg,
+                   std::exception_ptr /* e */
+                   ) override {
+    throw FormulaException("Error when lexing: " + msg);
+  }
+};
+
+class MyFormulaListener : public FormulaBaseListener {
+ public:
+  void exitLiteral(FormulaParser::LiteralContext *ctx) override {
+    program_.PushLeaf(stod(ctx->NUMBER()->getSymbol()->getText()));
+  }
+
+  void exitCell(FormulaParser::CellContext *ctx) override {
+    auto pos = Position::FromString(ctx->CELL()->getSymbol()->getText());
+
+    if (!pos.IsValid()) {
+      throw FormulaException("Wrong cell ref");
+    }
+
+    refs_.insert(pos);
+    program_.PushLeaf(pos);
+  }
+
+  void exitUnaryOp(FormulaParser::UnaryOpContext *ctx) override {
+    if (ctx->ADD()) {
+      program_.PushUnaryOp('+');
+    } else if (ctx->SUB()) {
+      program_.PushUnaryOp('-');
+    }
+  }
+
+  void exitBinaryOp(FormulaParser::BinaryOpContext *ctx) override {
+    if (ctx->MUL()) {
+      program_.PushBinaryOp('*');
+    } else if (ctx->DIV()) {
+      program_.PushBinaryOp('/');
+    } else if (ctx->ADD()) {
+      program_.PushBinaryOp('+');
+    } else if (ctx->SUB()) {
+      program_.PushBinaryOp('-');
+    }
+  }
+
+  unique_ptr<Formula> FlushResult() {
+    auto formula = make_unique<Formula>();
+
+    vector<Position> refs(refs_.begin(), refs_.end());
+    formula->SetReferencedCells(std::move(refs));
+    program_.ShrinkToFit();
+    formula->SetProgram(std::move(program_));
+    return formula;
+  }
+
+ private:
+  set<Position> refs_;
+  // Exit events come in postfix order, as the program is stored
+  FormulaProgram program_;
+};
+
+std::unique_ptr<Formula> ParseFormulaAntlr(std::string expression, Sheet& sheet) {
+  istringstream ss(expression);
+  antlr4::ANTLRInputStream input(ss);
+
+  FormulaLexer lexer(&input);
+  BailErrorListener error_listener;
+  lexer.removeErrorListeners();
+  lexer.addErrorListener(&error_listener);
+
+  antlr4::CommonTokenStream tokens(&lexer);
+
+  FormulaParser parser(&tokens);
+  auto error_handler = std::make_shared<antlr4::BailErrorStrategy>();
+  parser.setErrorHandler(error_handler);
+  parser.removeErrorListeners();
+
+  antlr4::tree::ParseTree* tree = nullptr;
+  try {
+    tree = parser.main();
+  } catch (std::exception &e) {
+    ostringstream ess;
+    ess << "Error when parsing: " << e.what();
+    throw FormulaException(ess.str());
+  }
+
+  MyFormulaListener listener;
+  antlr4::tree::ParseTreeWalker::DEFAULT.walk(&listener, tree);
+
+  return listener.FlushResult();
+}
@@ -0,0 +1,167 @@
+#include "formula_program.h"
+
+#include <algorithm>
+#include <array>
+
+using namespace std;
+
+namespace {
+
+ostream& operator<<(ostream& o, const Position& p) {
+  return o << p.ToString();
+}
+
+IFormula::Value EvaluateCell(const ICell* cell_ptr) {
+  if (!cell_ptr) {
+    return 0.0;
+  }
+
+  auto value = cell_ptr->GetValue();
+  if (holds_alternative<double>(value)) {
+    return get<double>(value);
+  }
+
+  if (holds_alternative<string>(value)) {
+    string& text = get<string>(value);
+    if (text.empty()) {
+      return 0.0;
+    }
+
+    try {
+      size_t pos;
+      if (double val = stod(text, &pos); pos == text.size()) {
+        return val;
+      }
+      return FormulaError(FormulaError::Category::Value);
+    } catch (...) {
+      return FormulaError(FormulaError::Category::Value);
+    }
+  }
+
+  if (holds_alternative<FormulaError>(value)) {
+    return get<FormulaError>(value);
+  }
+
+  throw runtime_error("undecideable value");
+}
+
+// Operator at the root of the subtree that ends with the node, 0 if it
+// is not a binary one
+char GetRootOp(const FormulaNode& node) {
+  const auto* op = get_if<BinaryOp>(&node);
+  return op ? op->op : 0;
+}
+
+// Prints the subtree ending at a node: its operands are found through
+// the first node of every subtree, computed in one pass
+class ProgramPrinter {
+ public:
+  ProgramPrinter(const FormulaProgram::Nodes& nodes, ostream& o)
+    : nodes_(nodes)
+    , o_(o)
+    , starts_(nodes.size())
+  {
+    vector<size_t> operands;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      if (holds_alternative<BinaryOp>(nodes[i])) {
+        operands.pop_back();
+      } else if (!holds_alternative<UnaryOp>(nodes[i])) {
+        operands.push_back(i);
+      }
+      starts_[i] = operands.back();
+    }
+  }
+
+  void Print(size_t i) {
+    const auto& node = nodes_[i];
+    if (const auto* op = get_if<BinaryOp>(&node)) {
+      const size_t rhs = i - 1;
+      const size_t lhs = starts_[rhs] - 1;
+      PrintOperand(lhs, op->NeedsLhsParens(GetRootOp(nodes_[lhs])));
+      o_ << *op;
+      PrintOperand(rhs, op->NeedsRhsParens(GetRootOp(nodes_[rhs])));
+    } else if (const auto* op = get_if<UnaryOp>(&node)) {
+      o_ << *op;
+      PrintOperand(i - 1, op->NeedsParens(GetRootOp(nodes_[i - 1])));
+    } else {
+      visit([this](const auto& leaf) {
+        o_ << leaf;
+      }, node);
+    }
+  }
+
+ private:
+  const FormulaProgram::Nodes& nodes_;
+  ostream& o_;
+  vector<size_t> starts_;
+
+  void PrintOperand(size_t i, bool parens) {
+    o_ << (parens ? "(" : "");
+    Print(i);
+    o_ << (parens ? ")" : "");
+  }
+};
+
+}
+
+void FormulaProgram::PushLeaf(FormulaNode node) {
+  nodes_.push_back(move(node));
+  max_depth_ = max(max_depth_, ++depth_);
+}
+
+void FormulaProgram::PushUnaryOp(char op) {
+  nodes_.push_back(UnaryOp{op});
+}
+
+void FormulaProgram::PushBinaryOp(char op) {
+  nodes_.push_back(BinaryOp{op});
+  --depth_;
+}
+
+void FormulaProgram::ShrinkToFit() {
+  nodes_.shrink_to_fit();
+}
+
+// Returns at the first error met: in postfix order it is the one that a
+// recursive evaluation, which stops at an erroneous operand, meets first
+IFormula::Value FormulaProgram::Evaluate(const CellGetter& get_cell) const {
+  array<double, INLINE_STACK_SIZE> inline_stack;
+  vector<double> heap_stack;
+  double* stack = inline_stack.data();
+  if (max_depth_ > INLINE_STACK_SIZE) {
+    heap_stack.resize(max_depth_);
+    stack = heap_stack.data();
+  }
+
+  size_t size = 0;
+  for (const auto& node : nodes_) {
+    if (const auto* value = get_if<double>(&node)) {
+      stack[size++] = *value;
+    } else if (const auto* pos = get_if<Position>(&node)) {
+      auto value = EvaluateCell(get_cell(*pos));
+      if (holds_alternative<FormulaError>(value)) {
+        return value;
+      }
+      stack[size++] = get<double>(value);
+    } else if (const auto* op = get_if<BinaryOp>(&node)) {
+      --size;
+      auto value = (*op)(stack[size - 1], stack[size]);
+      if (holds_alternative<FormulaError>(value)) {
+        return value;
+      }
+      stack[size - 1] = get<double>(value);
+    } else if (const auto* op = get_if<UnaryOp>(&node)) {
+      stack[size - 1] = get<double>((*op)(stack[size - 1]));
+    } else {
+      return get<FormulaError>(node);
+    }
+  }
+  return stack[0];
+}
+
+ostream& operator<<(ostream& o, const FormulaProgram& program) {
+  if (!program.nodes_.empty()) {
+    ProgramPrinter(program.nodes_, o).Print(program.nodes_.size() - 1);
+  }
+  return o;
+}
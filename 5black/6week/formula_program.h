@@ -0,0 +1,45 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <vector>
+
+#include "binary_op.h"
+#include "common_etc.h"
+#include "formula_node_part.h"
+#include "unary_op.h"
+
+// Formula nodes in postfix order: operands go right before their
+// operator. The array is evaluated in one pass by a stack machine, and
+// a cell ref may be replaced by another leaf in place.
+class FormulaProgram {
+ public:
+  using Nodes = std::vector<FormulaNode>;
+  // Cell at the position held by a leaf, nullptr if it is empty
+  using CellGetter = std::function<const ICell*(Position)>;
+
+  void PushLeaf(FormulaNode node);
+  void PushUnaryOp(char op);
+  void PushBinaryOp(char op);
+  // Drops the spare capacity left by pushes, for a complete program
+  void ShrinkToFit();
+
+  IFormula::Value Evaluate(const CellGetter& get_cell) const;
+
+  Nodes::iterator begin() { return nodes_.begin(); }
+  Nodes::iterator end() { return nodes_.end(); }
+  Nodes::const_iterator begin() const { return nodes_.begin(); }
+  Nodes::const_iterator end() const { return nodes_.end(); }
+
+ private:
+  Nodes nodes_;
+  size_t depth_ = 0;
+  size_t max_depth_ = 0;
+
+  // Operands of small formulas live on the stack of Evaluate
+  static const size_t INLINE_STACK_SIZE = 32;
+
+  friend std::ostream& operator<<(std::ostream& o, const FormulaProgram& program);
+};
+
+std::ostream& operator<<(std::ostream& o, const FormulaProgram& program);
@@ -1,3 +1,6 @@
+#include <functional>
+#include <map>
+#include <random>
 #include <sstream>
 
 #include "common.h"
@@ -6,6 +9,9 @@
 #include "test_runner.h"
 #include "sheet_impl.h"
 
+// The ANTLR grammar parser, slow. Kept only as the reference for the tests.
+std::unique_ptr<Formula> ParseFormulaAntlr(std::string expression, Sheet& sheet);
+
 std::ostream& operator<<(std::ostream& output, Position pos) {
   return output << "(" << pos.row << ", " << pos.col << ")";
 }
@@ -668,6 +674,194 @@ void TestPascalTriangle() {
   ASSERT(TestPascalTrianglePart(200) < 4000ms);
 }
 
+// Expression and referenced cells, or the kind of exception thrown
+std::string DescribeParsing(std::function<std::unique_ptr<IFormula>()> parse) {
+  std::ostringstream ss;
+  try {
+    auto formula = parse();
+    ss << formula->GetExpression() << " " << formula->GetReferencedCells();
+  } catch (const FormulaException&) {
+    ss << "FormulaException";
+  } catch (const std::out_of_range&) {
+    ss << "out_of_range";
+  }
+  return ss.str();
+}
+
+void CheckParsersAgree(const std::string& expression, Sheet& sheet) {
+  ASSERT_EQUAL(
+    DescribeParsing([&] { return ParseFormula(expression, sheet); }),
+    DescribeParsing([&] { return ParseFormulaAntlr(expression, sheet); })
+  );
+}
+
+void TestFormulaParserMatchesAntlr() {
+  auto sheet_ptr = CreateSheet();
+  auto& sheet = *dynamic_cast<Sheet*>(sheet_ptr.get());
+
+  for (const std::string expression : {
+      "", " ", "1", "-1", "--1", "+-+1", "1+2*3", "(1+2)*3", "1-2-3", "1-(2-3)",
+      "1/2/3", "1/(2/3)", "-1*2", "-(1+2)", "1*-2", "1--2", "2*(3)", "((1))",
+      ".5", "1.5", "1.", "1.e5", "1e5", "1E+5", "1e-5", "1e", "1e+", "1.5.3",
+      "1e999", "1e-999", "1e999+", "A0+1e999", "1e999+A0",
+      "A1", "a1", "A01", "A", "1A1", "A1B", "XFD16384", "XFD16385", "XFE16384",
+      "ABCDEFGHIJKLMNOPQRS1234567890", "A0", "A0+", "A1 +\tB2\n*\rC3",
+      "()", "(1", "1)", "1 2", "*1", "1*", "1+*2", "1\v", "1 x", "=1",
+  }) {
+    CheckParsersAgree(expression, sheet);
+  }
+
+  const std::vector<std::string> tokens = {
+    "1", "23", "4.5", ".6", "7e8", "9E-1", "1.", "e", "A1", "B12", "XFD16384",
+    "A0", "(", ")", "+", "-", "*", "/", " ",
+  };
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<size_t> token(0, tokens.size() - 1);
+  std::uniform_int_distribution<size_t> length(1, 12);
+  for (int i = 0; i < 10000; ++i) {
+    std::string expression;
+    for (size_t n = length(gen); n > 0; --n) {
+      expression += tokens[token(gen)];
+    }
+    CheckParsersAgree(expression, sheet);
+  }
+}
+
+// Not a unit test: prints the time of both parsers on a bulk import
+void BenchFormulaBulkParse() {
+  auto sheet_ptr = CreateSheet();
+  auto& sheet = *dynamic_cast<Sheet*>(sheet_ptr.get());
+
+  std::vector<std::string> expressions;
+  for (int i = 0; i < 100000; ++i) {
+    const Position lhs{i % 1000, i % 26};
+    const Position rhs{i % 997, i % 53};
+    expressions.push_back("(" + lhs.ToString() + "+" + rhs.ToString() + ")*" + std::to_string(i % 7) + ".5-1e-3");
+  }
+
+  DurationMeter<milliseconds> fast;
+  for (const auto& expression : expressions) {
+    ParseFormula(expression, sheet);
+  }
+  const auto fast_duration = fast.Get();
+
+  DurationMeter<milliseconds> antlr;
+  for (const auto& expression : expressions) {
+    ParseFormulaAntlr(expression, sheet);
+  }
+  const auto antlr_duration = antlr.Get();
+
+  cerr << "Bulk parse of " << expressions.size() << " formulas: " << fast_duration
+       << ", ANTLR " << antlr_duration << endl;
+}
+
+void TestSparseCells() {
+  auto sheet = CreateSheet();
+  sheet->SetCell("A1"_pos, "1");
+  sheet->SetCell("Z100"_pos, "2");
+  sheet->SetCell("B2"_pos, "=A1+Z100");
+
+  // Lines shift under the cells, dependencies must follow them
+  sheet->InsertRows(1, 10);
+  sheet->InsertCols(0, 9);
+  ASSERT_EQUAL(sheet->GetCell("K12"_pos)->GetText(), "=J1+AI110");
+  sheet->SetCell("AI110"_pos, "5");
+  ASSERT_EQUAL(sheet->GetCell("K12"_pos)->GetValue(), ICell::Value(6.0));
+
+  sheet->DeleteCols(0, 9);
+  sheet->DeleteRows(1, 10);
+  ASSERT_EQUAL(sheet->GetCell("B2"_pos)->GetText(), "=A1+Z100");
+  sheet->SetCell("A1"_pos, "3");
+  ASSERT_EQUAL(sheet->GetCell("B2"_pos)->GetValue(), ICell::Value(8.0));
+  ASSERT(sheet->GetCell("K12"_pos) == nullptr);
+
+  std::ostringstream texts;
+  sheet = CreateSheet();
+  sheet->SetCell("A1"_pos, "a");
+  sheet->SetCell("C1"_pos, "c");
+  sheet->SetCell("B3"_pos, "b");
+  sheet->PrintTexts(texts);
+  ASSERT_EQUAL(texts.str(), "a\t\tc\n\t\t\n\tb\t\n");
+
+  const auto maxp = Position{Position::kMaxRows - 1, Position::kMaxCols - 1};
+  sheet->SetCell(maxp, "far");
+  ASSERT_EQUAL(sheet->GetPrintableSize(), (Size{Position::kMaxRows, Position::kMaxCols}));
+  sheet->ClearCell(maxp);
+  ASSERT(sheet->GetCell(maxp) == nullptr);
+  ASSERT_EQUAL(sheet->GetPrintableSize(), (Size{3, 3}));
+}
+
+// Structural edits against a plain map of texts
+void TestRandomLineEdits() {
+  auto sheet = CreateSheet();
+  std::map<Position, std::string> texts;
+  std::mt19937 gen(42);
+  auto random = [&gen](int bound) {
+    return std::uniform_int_distribution<int>(0, bound - 1)(gen);
+  };
+  const int size = 40;
+
+  for (int step = 0; step < 2000; ++step) {
+    const int line = random(size);
+    const int count = 1 + random(3);
+    std::map<Position, std::string> next;
+    switch (random(7)) {
+    case 0:
+    case 1: {
+      const Position pos = {random(size), random(size)};
+      const std::string text = std::to_string(step);
+      sheet->SetCell(pos, text);
+      texts[pos] = text;
+      continue;
+    }
+    case 2:
+      sheet->InsertRows(line, count);
+      for (const auto& [pos, text] : texts) {
+        next[{pos.row < line ? pos.row : pos.row + count, pos.col}] = text;
+      }
+      break;
+    case 3:
+      sheet->InsertCols(line, count);
+      for (const auto& [pos, text] : texts) {
+        next[{pos.row, pos.col < line ? pos.col : pos.col + count}] = text;
+      }
+      break;
+    case 4:
+      sheet->DeleteRows(line, count);
+      for (const auto& [pos, text] : texts) {
+        if (pos.row < line || pos.row >= line + count) {
+          next[{pos.row < line ? pos.row : pos.row - count, pos.col}] = text;
+        }
+      }
+      break;
+    case 5:
+      sheet->DeleteCols(line, count);
+      for (const auto& [pos, text] : texts) {
+        if (pos.col < line || pos.col >= line + count) {
+          next[{pos.row, pos.col < line ? pos.col : pos.col - count}] = text;
+        }
+      }
+      break;
+    case 6: {
+      const Position pos = {random(size), line};
+      sheet->ClearCell(pos);
+      texts.erase(pos);
+      next = std::move(texts);
+      break;
+    }
+    }
+    texts = std::move(next);
+
+    Size printable;
+    for (const auto& [pos, text] : texts) {
+      ASSERT_EQUAL(sheet->GetCell(pos)->GetText(), text);
+      printable.rows = std::max(printable.rows, pos.row + 1);
+      printable.cols = std::max(printable.cols, pos.col + 1);
+    }
+    ASSERT_EQUAL(sheet->GetPrintableSize(), printable);
+  }
+}
+
 void TestInvalidate() {
   auto sheet = CreateSheet();
   sheet->SetCell("A1"_pos, "=A2");
@@ -676,31 +870,36 @@ void TestInvalidate() {
   ASSERT_EQUAL(get<double>(sheet->GetCell("A1"_pos)->GetValue()), 42.0);
 }
 
-// void TestHeavyInserts() {
-//   LOG_DURATION("Heavy inserts");
-//   auto sheet = BuildPascal(100);
-
-//   CheckPascal(*sheet.get(), 100);
-//   for (int i = 0; i < 100; ++i) {
-//     sheet->InsertRows(0);
-//   }
-//   for (int i = 0; i < 100; ++i) {
-//     sheet->InsertCols(0);
-//   }
-//   for (int i = 0; i < 100; ++i) {
-//     sheet->DeleteRows(0);
-//   }
-//   for (int i = 0; i < 100; ++i) {
-//     sheet->DeleteCols(0);
-//   }
-//   CheckPascal(*sheet.get(), 100);
-
-//   PrintSheetStats(sheet);
-// }
+void TestHeavyInserts() {
+  LOG_DURATION("Heavy inserts");
+  auto sheet = BuildPascal(100);
+
+  CheckPascal(*sheet.get(), 100);
+  for (int i = 0; i < 100; ++i) {
+    sheet->InsertRows(0);
+  }
+  for (int i = 0; i < 100; ++i) {
+    sheet->InsertCols(0);
+  }
+  for (int i = 0; i < 100; ++i) {
+    sheet->DeleteRows(0);
+  }
+  for (int i = 0; i < 100; ++i) {
+    sheet->DeleteCols(0);
+  }
+  CheckPascal(*sheet.get(), 100);
+
+  PrintSheetStats(sheet);
+}
 
 }  // namespace
 
-int main() {
+int main(int argc, const char* argv[]) {
+  if (argc == 2 && std::string_view(argv[1]) == "bench_parse") {
+    BenchFormulaBulkParse();
+    return 0;
+  }
+
   TestRunner tr;
   RUN_TEST(tr, TestPositionAndStringConversion);
   RUN_TEST(tr, TestPositionToStringInvalid);
@@ -731,6 +930,9 @@ int main() {
   RUN_TEST(tr, TestCellSelfCircularReference);
   RUN_TEST(tr, TestPascalTriangle);
   RUN_TEST(tr, TestInvalidate);
-  // RUN_TEST(tr, TestHeavyInserts);
+  RUN_TEST(tr, TestSparseCells);
+  RUN_TEST(tr, TestFormulaParserMatchesAntlr);
+  RUN_TEST(tr, TestRandomLineEdits);
+  RUN_TEST(tr, TestHeavyInserts);
   return 0;
 }
@@ -1,8 +1,10 @@
 #include "sheet_impl.h"
 
+#include <algorithm>
 #include <stdexcept>
 #include <ostream>
 #include <sstream>
+#include <tuple>
 
 #include "profile.h"
 #include "cell_impl.h"
@@ -18,7 +20,8 @@ std::string Sheet::GetStats() const {
   ss << "InsertRow: " << m_row_insert.Get() << "\n";
   ss << "InsertCol: " << m_col_insert.Get() << "\n";
   ss << "DeleteRow: " << m_row_delete.Get() << "\n";
-  ss << "DeleteCol: " << m_col_delete.Get() << "\n\n";
+  ss << "DeleteCol: " << m_col_delete.Get() << "\n";
+  ss << "PrintableSize: " << m_printable_size.Get() << "\n\n";
 
   ss << "Cell::Set: " << m_cell_set.Get() << "\n";
   ss << "Cell::Refs: " << m_cell_refs.Get() << "\n";
@@ -26,19 +29,6 @@ std::string Sheet::GetStats() const {
   ss << "Cell::InvalidateCache: " << m_cell_invalidate.Get() << "\n";
   ss << "Cell::FormulaParsing: " << m_cell_set_formula_parsing.Get() << "\n\n";
 
-  ss << "FormulaParsing::Prepare: " << m_fp_prepare.Get() << "\n";
-  ss << "FormulaParsing::Tree: " << m_fp_get_tree.Get() << "\n";
-  ss << "FormulaParsing::Walk: " << m_fp_walk.Get() << "\n";
-  ss << "FormulaParsing::Walk::Lit: " << m_fp_walk_lit.Get() << "\n";
-  ss << "FormulaParsing::Walk::Cell: " << m_fp_walk_cell.Get() << "\n";
-  ss << "FormulaParsing::Walk::Cell::Text: " << m_fp_walk_cell_text.Get() << "\n";
-  ss << "FormulaParsing::Walk::Cell::Pos: " << m_fp_walk_cell_pos.Get() << "\n";
-  ss << "FormulaParsing::Walk::Cell::Refs: " << m_fp_walk_cell_refs.Get() << "\n";
-  ss << "FormulaParsing::Walk::Cell::Mem: " << m_fp_walk_cell_mem.Get() << "\n";
-  ss << "FormulaParsing::Walk::UnaryOp: " << m_fp_walk_op_1.Get() << "\n";
-  ss << "FormulaParsing::Walk::BinaryOp: " << m_fp_walk_op_2.Get() << "\n";
-  ss << "FormulaParsing::Walk::Flush: " << m_fp_walk_flush.Get() << "\n\n";
-
   return ss.str();
 }
 
@@ -48,7 +38,13 @@ void Sheet::SetCell(Position pos, std::string text) {
     throw InvalidPositionException("SetCell: invalid position");
   }
 
-  InsertCell(pos).SetText(text);
+  const auto key = InsertKey(pos);
+  auto& cell = *cells_.Find(key);
+  const bool had_text = cell.HasText();
+  cell.SetText(text);
+  if (cell.HasText() != had_text) {
+    CountText(key, had_text ? -1 : 1);
+  }
 }
 
 const ICell* Sheet::GetCell(Position pos) const {
@@ -56,10 +52,7 @@ const ICell* Sheet::GetCell(Position pos) const {
     throw InvalidPositionException("GetCell: invalid position");
   }
 
-  if (pos.col < static_cast<int>(table_.size()) && pos.row < static_cast<int>(table_[pos.col].size())) {
-    return table_[pos.col][pos.row].get();
-  }
-  return nullptr;
+  return FindCell(pos);
 }
 
 ICell* Sheet::GetCell(Position pos) {
@@ -67,26 +60,11 @@ ICell* Sheet::GetCell(Position pos) {
     throw InvalidPositionException("GetCell: invalid position");
   }
 
-  if (pos.col < static_cast<int>(table_.size()) && pos.row < static_cast<int>(table_[pos.col].size())) {
-    return table_[pos.col][pos.row].get();
-  }
-  return nullptr;
+  return FindCell(pos);
 }
 
 Cell& Sheet::InsertCell(Position pos) {
-  METER_DURATION(m_insert);
-  if (static_cast<size_t>(pos.col) >= table_.size()) {
-    table_.resize(pos.col + 1);
-  }
-  if (static_cast<size_t>(pos.row) >= table_[pos.col].size()) {
-    table_[pos.col].resize(pos.row + 1);
-  }
-
-  auto& cell_ref = table_[pos.col][pos.row];
-  if (!cell_ref) {
-    cell_ref = make_shared<Cell>(*this);
-  }
-  return *cell_ref.get();
+  return *cells_.Find(InsertKey(pos));
 }
 
 void Sheet::ClearCell(Position pos) {
@@ -95,32 +73,22 @@ void Sheet::ClearCell(Position pos) {
     throw InvalidPositionException("ClearCell: invalid position");
   }
 
-  if (!(pos.col < static_cast<int>(table_.size())) || !(pos.row < static_cast<int>(table_[pos.col].size()))) {
-    return;
-  }
-
-  bool need_fit = false;
-  if (auto& cell_ptr = table_[pos.col][pos.row]; cell_ptr) {
-    cell_ptr->SetText("");
-    if (cell_ptr->IsFree()) {
-      cell_ptr.reset();
-      need_fit = true;
-    }
-  }
-
-  // Если у нас была удалена логическая ячейка, то
-  // приводим реальный размер таблицы с соответствием с логическим
-  // при этом ёмкость векторов остаётся строго в диапазоне максимальных позиций
-  if (need_fit) {
-    auto s = GetSize();
-    if (pos.col >= s.cols) {
-      table_.resize(s.cols);
-    } else if (pos.row >= s.rows) {
-      table_[pos.col].resize(s.rows);
+  if (auto key = FindKey(pos); key) {
+    if (auto cell_ptr = cells_.Find(*key); cell_ptr) {
+      if (cell_ptr->HasText()) {
+        CountText(*key, -1);
+      }
+      cell_ptr->SetText("");
+      // На ячейку ссылаются формулы, она должна остаться на месте
+      if (cell_ptr->IsFree()) {
+        EraseCell(*key);
+      }
     }
   }
 }
 
+// Ячейки и формулы ссылаются на id строк и столбцов, так что
+// достаточно сдвинуть индексы
 void Sheet::InsertRows(int before, int count) {
   METER_DURATION(m_row_insert);
   const auto s = GetSize();
@@ -128,20 +96,7 @@ void Sheet::InsertRows(int before, int count) {
     throw TableTooBigException("");
   }
 
-  // Вставка после области с ячейками ничего не меняет
-  if (before >= s.rows) {
-    return;
-  }
-
-  for (int col = 0; col < s.cols; ++col) {
-    if (before < static_cast<int>(table_[col].size())) {
-      table_[col].insert(table_[col].begin() + before, count, {});
-    }
-  }
-
-  ProcessNonEmptyCells([before, count](Position, Cell& cell) {
-    cell.HandleInsertedRows(before, count);
-  });
+  rows_.Insert(before, count);
 }
 
 void Sheet::InsertCols(int before, int count) {
@@ -151,133 +106,171 @@ void Sheet::InsertCols(int before, int count) {
     throw TableTooBigException("");
   }
 
-  // Вставка после области с ячейками ничего не меняет
-  if (before >= s.cols) {
-    return;
-  }
-  table_.insert(table_.begin() + before, count, {});
-
-  ProcessNonEmptyCells([before, count](Position, Cell& cell) {
-    cell.HandleInsertedCols(before, count);
-  });
+  cols_.Insert(before, count);
 }
 
 void Sheet::DeleteRows(int first, int count) {
   METER_DURATION(m_row_delete);
-  const auto s = GetSize();
+  DeleteCells(GetKeys(rows_.GetIds(first, count), cols_.GetIds(0, GetSize().cols)));
+  rows_.Erase(first, count);
+}
 
-  // Удаление после области с ячейками ничего не меняет
-  if (first >= s.rows) {
-    return;
-  }
+void Sheet::DeleteCols(int first, int count) {
+  METER_DURATION(m_col_delete);
+  DeleteCells(GetKeys(rows_.GetIds(0, GetSize().rows), cols_.GetIds(first, count)));
+  cols_.Erase(first, count);
+}
 
-  for (int col = 0; col < s.cols; ++col) {
-    if (first < static_cast<int>(table_[col].size())) {
-      const int actual_count = std::min(count, static_cast<int>(table_[col].size()) - first);
-      for (int row = first; row < first + actual_count; ++row) {
-        if (auto& cell_ptr = table_[col][row]; cell_ptr) {
-          cell_ptr->PrepareToDelete();
-        }
-      }
-      table_[col].erase(table_[col].begin() + first, table_[col].begin() + first + actual_count);
-    }
-  }
+Position Sheet::GetKey(Position pos) const {
+  return *FindKey(pos);
+}
+
+Position Sheet::GetPosition(Position key) const {
+  return {rows_.GetIndex(key.row), cols_.GetIndex(key.col)};
+}
 
-  ProcessNonEmptyCells([first, count](Position, Cell& cell) {
-    cell.HandleDeletedRows(first, count);
+const Cell* Sheet::GetCellByKey(Position key) const {
+  return cells_.Find(key);
+}
+
+Size Sheet::GetPrintableSize() const {
+  METER_DURATION(m_printable_size);
+  return {rows_.GetPrintableSize(), cols_.GetPrintableSize()};
+}
+
+void Sheet::PrintValues(std::ostream& output) const {
+  PrintCells(output, [&output](const Cell& cell) {
+    visit([&output](auto&& arg) {
+        output << arg;
+      }, cell.GetValue());
   });
 }
 
-void Sheet::DeleteCols(int first, int count) {
-  METER_DURATION(m_col_delete);
-  const auto s = GetSize();
+void Sheet::PrintTexts(std::ostream& output) const {
+  PrintCells(output, [&output](const Cell& cell) {
+    output << cell.GetText();
+  });
+}
 
-  // Удаление после конца области с ячейками ничего не меняет
-  if (first >= s.cols) {
-    return;
+std::optional<Position> Sheet::FindKey(Position pos) const {
+  auto row = rows_.FindId(pos.row);
+  if (!row) {
+    return nullopt;
+  }
+  auto col = cols_.FindId(pos.col);
+  if (!col) {
+    return nullopt;
   }
+  return Position{*row, *col};
+}
 
-  const int actual_count = std::min(count, s.cols - first);
-  for (int col = first; col < first + actual_count; ++col) {
-    for (size_t row = 0; row < table_[col].size(); ++row) {
-      if (auto& cell_ptr = table_[col][row]; cell_ptr) {
-        cell_ptr->PrepareToDelete();
-      }
-    }
+Cell* Sheet::FindCell(Position pos) const {
+  auto key = FindKey(pos);
+  return key ? cells_.Find(*key) : nullptr;
+}
+
+Position Sheet::InsertKey(Position pos) {
+  METER_DURATION(m_insert);
+  if (auto key = FindKey(pos); key && cells_.Find(*key)) {
+    return *key;
   }
-  table_.erase(table_.begin() + first, table_.begin() + first + actual_count);
 
-  ProcessNonEmptyCells([first, count](Position, Cell& cell) {
-    cell.HandleDeletedCols(first, count);
-  });
+  // Каждая ячейка держит id своих строки и столбца
+  const Position key = {rows_.Acquire(pos.row), cols_.Acquire(pos.col)};
+  cells_.Insert(key, *this);
+  return key;
 }
 
-Size Sheet::GetPrintableSize() const {
-  Size s = {0, 0};
-  ProcessNonEmptyCells([&s](Position p, Cell& cell) {
-    if (!cell.GetText().empty()) {
-      if (p.col + 1 > s.cols) {
-        s.cols = p.col + 1;
-      }
-      if (p.row + 1 > s.rows) {
-        s.rows = p.row + 1;
-      }
-    }
-  });
-  return s;
+void Sheet::EraseCell(Position key) {
+  cells_.Erase(key);
+  rows_.Release(key.row);
+  cols_.Release(key.col);
 }
 
-void Sheet::PrintValues(std::ostream& output) const {
-  auto s = GetPrintableSize();
-  for (int row = 0; row < s.rows; ++row) {
-    for (int col = 0; col < s.cols; ++col) {
-      if (col > 0) {
-        output << '\t';
-      }
-      if (auto cell_ptr = GetCell({row, col}); cell_ptr) {
-        visit([&output](auto&& arg) {
-            output << arg;
-          }, cell_ptr->GetValue());
+void Sheet::CountText(Position key, int delta) {
+  rows_.AddPrintable(key.row, delta);
+  cols_.AddPrintable(key.col, delta);
+}
+
+// Перебор строк и столбцов или, если он дольше, всех ячеек
+std::vector<Position> Sheet::GetKeys(const std::vector<int>& rows, const std::vector<int>& cols) const {
+  vector<Position> keys;
+  if (rows.size() * cols.size() <= cells_.GetSize()) {
+    for (int row : rows) {
+      for (int col : cols) {
+        if (cells_.Find({row, col})) {
+          keys.push_back({row, col});
+        }
       }
     }
-    output << '\n';
+    return keys;
   }
+
+  const unordered_set<int> row_set(rows.begin(), rows.end());
+  const unordered_set<int> col_set(cols.begin(), cols.end());
+  cells_.ForEach([&](Position key, Cell&) {
+    if (row_set.count(key.row) && col_set.count(key.col)) {
+      keys.push_back(key);
+    }
+  });
+  return keys;
 }
 
-void Sheet::PrintTexts(std::ostream& output) const {
-  auto s = GetPrintableSize();
-  for (int row = 0; row < s.rows; ++row) {
-    for (int col = 0; col < s.cols; ++col) {
-      if (col > 0) {
-        output << '\t';
-      }
-      if (auto cell_ptr = GetCell({row, col}); cell_ptr) {
-        output << cell_ptr->GetText();
-      }
+// Сначала все удаляемые ячейки отвязываются друг от друга и только
+// потом удаляются: формулы ещё находят по ключам позиции ссылок
+void Sheet::DeleteCells(const std::vector<Position>& keys) {
+  for (auto key : keys) {
+    auto cell_ptr = cells_.Find(key);
+    if (cell_ptr->HasText()) {
+      CountText(key, -1);
     }
-    output << '\n';
+    cell_ptr->PrepareToDelete(key);
+  }
+  for (auto key : keys) {
+    EraseCell(key);
   }
 }
 
 void Sheet::ProcessNonEmptyCells(std::function<void(Position, Cell&)> f) const {
-  for (int col = 0; col < static_cast<int>(table_.size()); ++col) {
-    for (int row = 0; row < static_cast<int>(table_[col].size()); ++row) {
-      if (auto ptr = table_[col][row].get(); ptr) {
-        f({row, col}, *ptr);
-      }
+  cells_.ForEach([this, &f](Position key, Cell& cell) {
+    f(GetPosition(key), cell);
+  });
+}
+
+std::vector<Position> Sheet::GetPositions(std::function<bool(Position)> filter) const {
+  vector<Position> positions;
+  ProcessNonEmptyCells([&positions, &filter](Position pos, Cell&) {
+    if (filter(pos)) {
+      positions.push_back(pos);
+    }
+  });
+  sort(positions.begin(), positions.end(), [](Position lhs, Position rhs) {
+    return tie(lhs.row, lhs.col) < tie(rhs.row, rhs.col);
+  });
+  return positions;
+}
+
+void Sheet::PrintCells(std::ostream& output, std::function<void(const Cell&)> print) const {
+  const auto s = GetPrintableSize();
+  const auto positions = GetPositions([s](Position pos) {
+    return pos.row < s.rows && pos.col < s.cols;
+  });
+
+  // Пустые места между ячейками выводятся только разделителями
+  Position current = {0, 0};
+  for (auto pos : positions) {
+    for (; current.row < pos.row; ++current.row, current.col = 0) {
+      output << string(s.cols - 1 - current.col, '\t') << '\n';
     }
+    output << string(pos.col - current.col, '\t');
+    print(*FindCell(pos));
+    current.col = pos.col;
+  }
+  for (; current.row < s.rows; ++current.row, current.col = 0) {
+    output << string(s.cols - 1 - current.col, '\t') << '\n';
   }
 }
 
 Size Sheet::GetSize() const {
-  Size s = {0, 0};
-  ProcessNonEmptyCells([&s](Position p, Cell& cell) {
-    if (p.col + 1 > s.cols) {
-      s.cols = p.col + 1;
-    }
-    if (p.row + 1 > s.rows) {
-      s.rows = p.row + 1;
-    }
-  });
-  return s;
-}
\ No newline at end of file
+  return {rows_.GetSize(), cols_.GetSize()};
+}
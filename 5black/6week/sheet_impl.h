@@ -1,32 +1,40 @@
+#pragma once
+
 #include <functional>
 #include <memory>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "axis_index.h"
 #include "cell_impl.h"
+#include "cell_table.h"
 #include "common_etc.h"
 #include "profile.h"
 
 class Sheet : public ISheet {
-  using CellPtr = std::shared_ptr<Cell>;
-  using Column = std::vector<CellPtr>;
-  using Table = std::vector<Column>;
-
  public:
   void SetCell(Position pos, std::string text) override; // O(K*R), O(1)
-  const ICell* GetCell(Position pos) const override; // O(1)
-  ICell* GetCell(Position pos) override; // O(1)
-  Cell& InsertCell(Position pos); // O(K)
+  const ICell* GetCell(Position pos) const override; // O(log(N))
+  ICell* GetCell(Position pos) override; // O(log(N))
+  Cell& InsertCell(Position pos); // O(log(N))
   void ClearCell(Position pos) override; // O(K)
 
-  void InsertRows(int before, int count = 1) override;
-  void InsertCols(int before, int count = 1) override;
+  void InsertRows(int before, int count = 1) override; // O(log(N))
+  void InsertCols(int before, int count = 1) override; // O(log(N))
+
+  // D - deleted cells
+  void DeleteRows(int first, int count = 1) override; // O(log(N)+D*R)
+  void DeleteCols(int first, int count = 1) override; // O(log(N)+D*R)
 
-  void DeleteRows(int first, int count = 1) override;
-  void DeleteCols(int first, int count = 1) override;
+  // A cell is keyed by the ids of its row and column, which are kept
+  // by insertions and deletions of lines. N - rows or columns in use.
+  Position GetKey(Position pos) const; // O(log(N))
+  Position GetPosition(Position key) const; // O(log(N))
+  const Cell* GetCellByKey(Position key) const; // O(1)
 
-  Size GetPrintableSize() const override; // O(K)
+  Size GetPrintableSize() const override; // O(log(N))
 
   void PrintValues(std::ostream& output) const override;
   void PrintTexts(std::ostream& output) const override;
@@ -39,6 +47,7 @@ class Sheet : public ISheet {
   StatMeter<microseconds> m_row_delete;
   StatMeter<microseconds> m_col_insert;
   StatMeter<microseconds> m_col_delete;
+  mutable StatMeter<microseconds> m_printable_size;
 
   StatMeter<microseconds> m_cell_set;
   StatMeter<microseconds> m_cell_refs;
@@ -46,28 +55,32 @@ class Sheet : public ISheet {
   StatMeter<microseconds> m_cell_check_circular;
   StatMeter<microseconds> m_cell_set_formula_parsing;
 
-  StatMeter<microseconds> m_fp_prepare;
-  StatMeter<microseconds> m_fp_get_tree;
-  StatMeter<microseconds> m_fp_walk;
-  StatMeter<microseconds> m_fp_walk_lit;
-  StatMeter<microseconds> m_fp_walk_cell;
-  StatMeter<microseconds> m_fp_walk_cell_text;
-  StatMeter<microseconds> m_fp_walk_cell_pos;
-  StatMeter<microseconds> m_fp_walk_cell_refs;
-  StatMeter<microseconds> m_fp_walk_cell_mem;
-  StatMeter<microseconds> m_fp_walk_op_1;
-  StatMeter<microseconds> m_fp_walk_op_2;
-  StatMeter<microseconds> m_fp_walk_flush;
-
   std::string GetStats() const;
 
   size_t cc_epoch = 0;
 
  private:
-  Table table_;
+  // By keys
+  CellTable cells_;
+  AxisIndex rows_;
+  AxisIndex cols_;
+
+  std::optional<Position> FindKey(Position pos) const; // O(log(N))
+  Cell* FindCell(Position pos) const; // O(log(N))
+  // Key of the cell, inserted if needed
+  Position InsertKey(Position pos); // O(log(N))
+  void EraseCell(Position key); // O(log(N))
+  // Counts a cell with text on its row and column
+  void CountText(Position key, int delta); // O(log(N))
+  // Keys of the cells in the given rows and columns
+  std::vector<Position> GetKeys(const std::vector<int>& rows, const std::vector<int>& cols) const;
+  void DeleteCells(const std::vector<Position>& keys); // O(D*R)
 
-  void ProcessNonEmptyCells(std::function<void(Position, Cell&)> f) const; // O(K)
-  Size GetSize() const; // O(K)
+  void ProcessNonEmptyCells(std::function<void(Position, Cell&)> f) const; // O(K*log(N))
+  Size GetSize() const; // O(log(N))
+  // Positions of all cells matching the filter, sorted by row, then col
+  std::vector<Position> GetPositions(std::function<bool(Position)> filter) const; // O(K*log(K))
+  void PrintCells(std::ostream& output, std::function<void(const Cell&)> print) const; // O(K*log(K)+S)
 };
 
-std::unique_ptr<IFormula> ParseFormula(std::string expression, Sheet& sheet);
\ No newline at end of file
+std::unique_ptr<Formula> ParseFormula(std::string expression, Sheet& sheet);
\ No newline at end of file
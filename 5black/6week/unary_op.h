@@ -1,18 +1,18 @@
 #pragma once
 
-#include <memory>
 #include <ostream>
 
 #include "formula.h"
-#include "formula_node_part.h"
 
+// The operand is the formula node before the operator
 struct UnaryOp {
   char op;
-  std::unique_ptr<FormulaNode> arg;
 
   IFormula::Value operator()(double arg) const;
+
+  // Whether the operand is printed in parentheses, given the operator at
+  // the root of the operand, 0 for none
+  bool NeedsParens(char arg_op) const;
 };
 
 std::ostream& operator<<(std::ostream& o, const UnaryOp& op);
-
-IFormula::Value EvaluateNode(const UnaryOp& op, const ISheet& sheet);
\ No newline at end of file